@@ -0,0 +1,320 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// The reducers of bps_analysis.h against what they have to give for
+// sampled particles: g(r) against pairs counted over all pairs and g = 1
+// for an ideal gas, the radial profile against a uniform sphere with a
+// known flow and dispersion, and the temperature fitted to sampled
+// Maxwell-Juettner distributions. Particles at or beyond the speed of
+// light must not change the fit, and rmax beyond half the box is refused.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bps_analysis.h"
+#include "bps_constants.h"
+#include "bps_particle-array.h"
+#include "bps_periodic-box.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double c = BPS_CONST_SPEED_OF_LIGHT;
+
+  // the table rows the reducer writes, without the "#" lines
+  std::vector<std::vector<double> > rows(const Reducer& reducer,
+                                         std::string& header) {
+    std::ostringstream os;
+    reducer.write(os);
+    std::istringstream in(os.str());
+    std::vector<std::vector<double> > table;
+    header.clear();
+    for (std::string line; std::getline(in, line); ) {
+      if (line.empty()) continue;
+      if (line[0] == '#') {
+        if (header.empty()) header = line;
+        continue;
+      }
+      std::istringstream values(line);
+      table.push_back(std::vector<double>());
+      for (double x; values >> x; )
+        table.back().push_back(x);
+    }
+    return table;
+  }
+
+  double normal(check::Random& random) {
+    const double u = 1 - random.uniform();
+    return std::sqrt(-2*std::log(u))*std::cos(2*M_PI*random.uniform());
+  }
+
+  // uniform in the unit sphere
+  void direction(check::Random& random, double& x, double& y, double& z) {
+    do {
+      x = random.uniform(-1, 1);
+      y = random.uniform(-1, 1);
+      z = random.uniform(-1, 1);
+    } while (x*x + y*y + z*z > 1 || x*x + y*y + z*z == 0);
+  }
+
+  bool radialDistribution() {
+    const int n = 2000;
+    const int snapshots = 5;
+    const int bins = 20;
+    const double rmax = 0.4;
+    const PeriodicBox boxes[] = {PeriodicBox(1, 1, 1), PeriodicBox()};
+
+    check::Random random(3);
+    bool ok = true;
+    for (int b = 0; b < 2; b++) {
+      const PeriodicBox& box = boxes[b];
+      RadialDistribution g(rmax, bins, box);
+      std::vector<double> expected(bins, 0);
+      ParticleArray a(n);
+      for (int s = 0; s < snapshots; s++) {
+        for (int i = 0; i < n; i++) {
+          a.x[i] = random.uniform();
+          a.y[i] = random.uniform();
+          a.z[i] = random.uniform();
+        }
+        g.accumulate(a);
+
+        for (int i = 0; i < n; i++) {
+          for (int j = i + 1; j < n; j++) {
+            const double dx = box.minimumImage(a.x[j] - a.x[i], 0);
+            const double dy = box.minimumImage(a.y[j] - a.y[i], 1);
+            const double dz = box.minimumImage(a.z[j] - a.z[i], 2);
+            const double r = std::sqrt(dx*dx + dy*dy + dz*dz);
+            if (r < rmax)
+              expected[std::min(static_cast<int>(r/rmax*bins), bins - 1)]++;
+          }
+        }
+      }
+
+      std::string header;
+      const std::vector<std::vector<double> > table = rows(g, header);
+      double pairErrors = table.size() != static_cast<unsigned int>(bins);
+      double idealError = 0;
+      for (unsigned int k = 0; k < table.size(); k++) {
+        pairErrors += table[k][2] != expected[k];
+        // the statistical error is below 1% from r = 0.1 on
+        if (table[k][0] > 0.1) idealError = std::max(idealError,
+                                                     std::fabs(table[k][1]
+                                                               - 1));
+      }
+
+      std::printf("g(r) of %d uniform points in a %s box, %d snapshots\n", n,
+                  b == 0 ? "periodic" : "open", snapshots);
+      ok = check::expect("bins differing from all pairs", pairErrors, 0)
+           && ok;
+      // the open box misses the pairs across the faces
+      if (b == 0)
+        ok = check::expect("g(r) - 1 from r = 0.1 on", idealError, 0.05)
+             && ok;
+    }
+
+    int accepted = 0;
+    const double invalid[] = {0.51, 0, -0.1,
+                              std::numeric_limits<double>::quiet_NaN()};
+    for (int k = 0; k < 4; k++) {
+      try {
+        RadialDistribution(invalid[k], bins, boxes[0]);
+        accepted++;
+      } catch (std::invalid_argument&) {
+      }
+    }
+    try {
+      RadialDistribution(0.3, 0, boxes[0]);
+      accepted++;
+    } catch (std::invalid_argument&) {
+    }
+    try {
+      RadialDistribution(0.3, bins, PeriodicBox(1, 0.5, 1));
+      accepted++;
+    } catch (std::invalid_argument&) {
+    }
+    int rejected = 0;
+    try {
+      RadialDistribution(0.5, bins, boxes[0]);
+      RadialDistribution(2, bins, boxes[1]);
+    } catch (std::invalid_argument&) {
+      rejected++;
+    }
+    ok = check::expect("invalid rmax or bins accepted", accepted, 0) && ok;
+    return check::expect("valid rmax rejected", rejected, 0) && ok;
+  }
+
+  bool radialProfile() {
+    // a uniform sphere of radius 1 around an offset center, streaming
+    // outwards at v0 with an isotropic dispersion s
+    const int n = 100000;
+    const int bins = 10;
+    const double v0 = 1, s = 2, m = 3;
+    const double offset[] = {3, -2, 1};
+
+    check::Random random(5);
+    ParticleArray a(n);
+    for (int i = 0; i < n; i++) {
+      double x, y, z;
+      direction(random, x, y, z);
+      const double r = std::sqrt(x*x + y*y + z*z);
+      a.x[i] = x + offset[0];
+      a.y[i] = y + offset[1];
+      a.z[i] = z + offset[2];
+      a.vx[i] = v0*x/r + s*normal(random);
+      a.vy[i] = v0*y/r + s*normal(random);
+      a.vz[i] = v0*z/r + s*normal(random);
+      a.mass[i] = m;
+    }
+
+    // around the center of mass
+    RadialProfile profile(1, bins);
+    profile.accumulate(a);
+    std::string header;
+    const std::vector<std::vector<double> > table = rows(profile, header);
+
+    const double density = n/(4*M_PI/3);
+    const double sigma = std::sqrt(s*s + v0*v0/3);
+    double densityError = table.size() != static_cast<unsigned int>(bins);
+    double massError = 0, flowError = 0, sigmaError = 0;
+    // the inner shells hold too few particles to compare
+    for (unsigned int b = 3; b < table.size(); b++) {
+      densityError = std::max(densityError,
+                              std::fabs(table[b][1]/density - 1));
+      massError = std::max(massError,
+                           std::fabs(table[b][2]/(m*table[b][1]) - 1));
+      flowError = std::max(flowError, std::fabs(table[b][3] - v0));
+      sigmaError = std::max(sigmaError, std::fabs(table[b][4]/sigma - 1));
+    }
+
+    std::printf("radial profile of %d particles in a sphere, outer %d of %d"
+                " shells\n", n, bins - 3, bins);
+    bool ok = check::expect("number density, relative", densityError, 0.1);
+    // the table has six digits
+    ok = check::expect("mass density / number density - m, relative",
+                       massError, 1e-5) && ok;
+    ok = check::expect("radial velocity", flowError, 0.2) && ok;
+    return check::expect("dispersion, relative", sigmaError, 0.06) && ok;
+  }
+
+  // Maxwell-Juettner distribution over the rapidity, unnormalized
+  double juettner(const double theta, const double t) {
+    const double h = std::sinh(t/2);
+    return std::pow(std::sinh(t), 2)*std::cosh(t)*std::exp(-2*h*h/theta);
+  }
+
+  // speeds of kT = theta m c^2 by rejection in the rapidity
+  void sample(check::Random& random, const double theta, ParticleArray& a) {
+    const double cutoff = 2*std::asinh(std::sqrt(30*theta));
+    double peak = 0;
+    for (int k = 1; k <= 1000; k++)
+      peak = std::max(peak, juettner(theta, k*cutoff/1000));
+    peak *= 1.1;
+
+    for (int i = 0; i < a.size(); i++) {
+      double t;
+      do {
+        t = random.uniform(0, cutoff);
+      } while (random.uniform(0, peak) > juettner(theta, t));
+      double x, y, z;
+      direction(random, x, y, z);
+      const double v = c*std::tanh(t)/std::sqrt(x*x + y*y + z*z);
+      a.vx[i] = v*x;
+      a.vy[i] = v*y;
+      a.vz[i] = v*z;
+    }
+  }
+
+  // fitted temperature and distance to Maxwell-Juettner
+  void fit(const SpeedDistribution& speeds, double& temperature,
+           double& distance) {
+    std::string header;
+    rows(speeds, header);
+    temperature = distance = -1;
+    std::sscanf(header.c_str(), "# speed distribution: T %lf K, distance to"
+                " Maxwell-Juettner %lf", &temperature, &distance);
+  }
+
+  bool speedDistribution() {
+    const int n = 100000;
+    const double me = BPS_CONST_MASS_ELECTRON;
+    const double rest = me*c*c;
+    // non-relativistic, mildly and fully relativistic
+    const double thetas[] = {1e-6, 0.1, 10};
+
+    check::Random random(11);
+    bool ok = true;
+    for (int k = 0; k < 3; k++) {
+      const double theta = thetas[k];
+      ParticleArray a(n + 3);
+      for (int i = 0; i < n + 3; i++)
+        a.mass[i] = me;
+      sample(random, theta, a);
+
+      // at the speed of light, beyond it, and NaN
+      const double invalid[] = {c, 2*c,
+                                std::numeric_limits<double>::quiet_NaN()};
+      ParticleArray valid = a;
+      valid.resize(n);
+      for (int i = 0; i < 3; i++) {
+        a.vx[n + i] = invalid[i];
+        a.vy[n + i] = a.vz[n + i] = 0;
+      }
+
+      // vmax at about three times the mean speed
+      const double vmax = c*std::min(0.999, 3*std::sqrt(theta));
+      SpeedDistribution speeds(me, 30, vmax), clean(me, 30, vmax);
+      speeds.accumulate(a);
+      clean.accumulate(valid);
+
+      const double T = theta*rest/BPS_CONST_BOLTZMANN;
+      double fitted, distance, cleanFitted, cleanDistance;
+      fit(speeds, fitted, distance);
+      fit(clean, cleanFitted, cleanDistance);
+
+      std::printf("Maxwell-Juettner, kT = %g m c^2, %d electrons and 3 at"
+                  " v >= c\n", theta, n);
+      ok = check::expect("fitted temperature, relative",
+                         std::fabs(fitted/T - 1), 0.02) && ok;
+      ok = check::expect("distance to Maxwell-Juettner", distance, 0.02)
+           && ok;
+      ok = check::expect("skipped particles - 3",
+                         std::fabs(speeds.getSkipped() - 3), 0) && ok;
+      ok = check::expect("fit changed by them, relative",
+                         std::fabs(fitted/cleanFitted - 1), 0) && ok;
+    }
+    return ok;
+  }
+
+} // namespace
+
+int main() {
+  bool ok = radialDistribution();
+  ok = radialProfile() && ok;
+  ok = speedDistribution() && ok;
+  return ok ? 0 : 1;
+}
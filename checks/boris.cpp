@@ -0,0 +1,315 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// BorisPusher against analytic motion in uniform fields: the gyration of
+// a relativistic proton in a magnetic field and the E x B drift of slow
+// protons. The gyration is run through a UniformField and through a
+// CallbackField and a GriddedField of the same field, which have to give
+// the same orbits. At gamma = 1e4 the momenta have to keep their length,
+// velocities set between pushes have to be picked up, and invalid grids
+// are rejected.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_boris.h"
+#include "bps_constants.h"
+#include "bps_field.h"
+#include "bps_particle-array.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double c = BPS_CONST_SPEED_OF_LIGHT;
+  const double q = BPS_CONST_ELEMENTARY_CHARGE;
+  const double m = BPS_CONST_MASS_PROTON;
+
+  const int n = 200;
+  const int stepsPerTurn = 2000;
+  const int turns = 10;
+
+  // protons near the origin, moving in the xy plane with the given speed
+  ParticleArray protons(const double speed) {
+    check::Random random(5);
+    ParticleArray a(n);
+    for (int i = 0; i < n; i++) {
+      const double phase = random.uniform(0, 2*M_PI);
+      a.x[i] = random.uniform(-0.5, 0.5);
+      a.y[i] = random.uniform(-0.5, 0.5);
+      a.z[i] = random.uniform(-0.5, 0.5);
+      a.vx[i] = speed*std::cos(phase);
+      a.vy[i] = speed*std::sin(phase);
+      a.vz[i] = 0;
+      a.mass[i] = m;
+      a.charge[i] = q;
+    }
+    return a;
+  }
+
+  // the uniform magnetic field of 1 T along z through a callback
+  void callback(const ThreeVector&, const double, ThreeVector& e,
+                ThreeVector& b, void*) {
+    e = ThreeVector();
+    b = ThreeVector(0, 0, 1);
+  }
+
+  // Runs whole turns and returns the RMS distance of each orbit from its
+  // centre, the mean of the positions.
+  std::vector<double> gyrate(const ElectromagneticField& field,
+                             ParticleArray& a, const double dt) {
+    std::vector<double> sx(n, 0), sy(n, 0), sxx(n, 0), syy(n, 0);
+    BorisPusher pusher(field);
+    const int steps = turns*stepsPerTurn;
+    for (int s = 0; s < steps; s++) {
+      pusher.push(a, dt);
+      for (int i = 0; i < n; i++) {
+        sx[i] += a.x[i];
+        sy[i] += a.y[i];
+        sxx[i] += a.x[i]*a.x[i];
+        syy[i] += a.y[i]*a.y[i];
+      }
+    }
+
+    std::vector<double> radius(n);
+    for (int i = 0; i < n; i++) {
+      const double cx = sx[i]/steps, cy = sy[i]/steps;
+      radius[i] = std::sqrt(sxx[i]/steps - cx*cx + syy[i]/steps - cy*cy);
+    }
+    return radius;
+  }
+
+  bool gyration() {
+    const double speed = 0.5*c;
+    const double B = 1;
+    const double gamma = 1/std::sqrt(1 - 0.25);
+    const double exact = gamma*m*speed/(q*B);
+    const double dt = 2*M_PI*gamma*m/(q*B)/stepsPerTurn;
+
+    const UniformField uniform(ThreeVector(), ThreeVector(0, 0, B));
+    // orbits of radius 1.8 m through points within 0.5 m of the origin
+    GriddedField gridded(ThreeVector(-6, -6, -6), 0.5, 25, 25, 25);
+    gridded.sample(uniform);
+
+    const CallbackField function(callback);
+
+    ParticleArray a = protons(speed), g = protons(speed), f = protons(speed);
+    double t = check::seconds();
+    const std::vector<double> radius = gyrate(uniform, a, dt);
+    const double tUniform = check::seconds() - t;
+    t = check::seconds();
+    const std::vector<double> gridRadius = gyrate(gridded, g, dt);
+    const double tGridded = check::seconds() - t;
+    t = check::seconds();
+    gyrate(function, f, dt);
+    const double tCallback = check::seconds() - t;
+
+    double radiusError = 0, speedError = 0, gridError = 0, callbackError = 0;
+    for (int i = 0; i < n; i++) {
+      radiusError = std::max(radiusError,
+                             std::fabs(radius[i] - exact)/exact);
+      const ThreeVector v(a.vx[i], a.vy[i], a.vz[i]);
+      speedError = std::max(speedError, std::fabs(v.length() - speed)/speed);
+      const ThreeVector d(g.x[i] - a.x[i], g.y[i] - a.y[i], g.z[i] - a.z[i]);
+      gridError = std::max(gridError, d.length()/exact);
+      gridError = std::max(gridError,
+                           std::fabs(gridRadius[i] - radius[i])/exact);
+      const ThreeVector e(f.x[i] - a.x[i], f.y[i] - a.y[i], f.z[i] - a.z[i]);
+      callbackError = std::max(callbackError, e.length()/exact);
+    }
+
+    const double pushes = static_cast<double>(n)*turns*stepsPerTurn;
+    std::printf("gyration at 0.5 c in 1 T, %d protons, %d turns of %d"
+                " steps, pushes/s: uniform %.3g, gridded %.3g, callback"
+                " %.3g\n", n, turns, stepsPerTurn, pushes/tUniform,
+                pushes/tGridded, pushes/tCallback);
+    bool ok = check::expect("radius, relative", radiusError, 1e-5);
+    ok = check::expect("speed, relative", speedError, 1e-13) && ok;
+    ok = check::expect("gridded against uniform, relative", gridError,
+                       1e-9) && ok;
+    return check::expect("callback against uniform, relative",
+                         callbackError, 0) && ok;
+  }
+
+  // Electrons at gamma = 1e4 in a magnetic field keep |u|. Gamma computed
+  // from the velocities would only be good to about 1e-16 gamma^2.
+  bool ultrarelativistic() {
+    const double gamma = 1e4;
+    const double speed = c*std::sqrt(1 - 1/(gamma*gamma));
+    const double me = BPS_CONST_MASS_ELECTRON;
+    const double B = 1;
+    const double dt = 2*M_PI*gamma*me/(q*B)/stepsPerTurn;
+
+    const UniformField field(ThreeVector(), ThreeVector(0, 0, B));
+    ParticleArray a = protons(speed);
+    for (int i = 0; i < n; i++) {
+      a.mass[i] = me;
+      a.charge[i] = -q;
+    }
+    BorisPusher pusher(field);
+    pusher.push(a, dt);
+    std::vector<double> start(n);
+    for (int i = 0; i < n; i++)
+      start[i] = pusher.getMomentum(i).length();
+    for (int s = 1; s < turns*stepsPerTurn; s++)
+      pusher.push(a, dt);
+
+    double error = 0, fromVelocity = 0;
+    for (int i = 0; i < n; i++) {
+      error = std::max(error, std::fabs(pusher.getMomentum(i).length()
+                                        - start[i])/start[i]);
+      const ThreeVector v(a.vx[i], a.vy[i], a.vz[i]);
+      const double g = 1/std::sqrt(1 - v*v/(c*c));
+      fromVelocity = std::max(fromVelocity, std::fabs(g - gamma)/gamma);
+    }
+
+    std::printf("gyration at gamma = %g, %d electrons, %d turns\n", gamma,
+                n, turns);
+    std::printf("  gamma from the velocities, relative error %.1e\n",
+                fromVelocity);
+    return check::expect("|u|, relative", error, 1e-12);
+  }
+
+  // a velocity set between two pushes replaces the momentum of the pusher
+  bool changedVelocity() {
+    const ThreeVector zero;
+    const UniformField field(zero, zero);
+    ParticleArray a = protons(0.5*c);
+    BorisPusher pusher(field);
+    pusher.push(a, 1e-9);
+
+    const ThreeVector v(0.1*c, -0.2*c, 0.3*c);
+    a.vx[7] = v[0];
+    a.vy[7] = v[1];
+    a.vz[7] = v[2];
+    const ThreeVector r(a.x[7], a.y[7], a.z[7]);
+    pusher.push(a, 1e-9);
+
+    const ThreeVector d(a.x[7] - r[0] - v[0]*1e-9, a.y[7] - r[1] - v[1]*1e-9,
+                        a.z[7] - r[2] - v[2]*1e-9);
+    const ThreeVector w(a.vx[7], a.vy[7], a.vz[7]);
+    std::printf("velocity set between two pushes in no field\n");
+    const bool ok = check::expect("velocity afterwards, relative",
+                                  (w - v).length()/v.length(), 1e-15);
+    return check::expect("drift, relative", d.length()/(v.length()*1e-9),
+                         1e-6) && ok;
+  }
+
+  bool drift() {
+    const double E = 1e5, B = 1;
+    const ThreeVector exact(E/B, 0, 0);
+    const double dt = 2*M_PI*m/(q*B)/stepsPerTurn;
+    const int steps = turns*stepsPerTurn;
+
+    const UniformField field(ThreeVector(0, E, 0), ThreeVector(0, 0, B));
+    ParticleArray a = protons(0);
+    const ParticleArray start = a;
+    BorisPusher pusher(field);
+    for (int s = 0; s < steps; s++)
+      pusher.push(a, dt);
+
+    double error = 0;
+    for (int i = 0; i < n; i++) {
+      const ThreeVector d(a.x[i] - start.x[i], a.y[i] - start.y[i],
+                          a.z[i] - start.z[i]);
+      error = std::max(error, (d/(steps*dt) - exact).length()/exact.length());
+    }
+
+    std::printf("E x B drift, E = %g V/m, B = %g T, %d turns\n", E, B,
+                turns);
+    return check::expect("mean velocity against E/B, relative", error, 1e-4);
+  }
+
+  bool invalidGrids() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double spacings[] = {0, -1, nan, 1};
+    const int sizes[] = {2, 2, 2, 1};
+    int accepted = 0;
+    for (int k = 0; k < 4; k++) {
+      try {
+        GriddedField(ThreeVector(), spacings[k], 2, sizes[k], 2);
+        accepted++;
+      } catch (std::invalid_argument&) {
+      }
+    }
+
+    GriddedField grid(ThreeVector(), 1, 2, 3, 4);
+    const int points[][3] = {{-1, 0, 0}, {2, 0, 0}, {0, 3, 0}, {0, 0, 4},
+                             {0, -1, 0}};
+    for (int k = 0; k < 5; k++) {
+      try {
+        grid.set(points[k][0], points[k][1], points[k][2], ThreeVector(),
+                 ThreeVector());
+        accepted++;
+      } catch (std::out_of_range&) {
+      }
+    }
+    grid.set(1, 2, 3, ThreeVector(), ThreeVector());
+
+    std::printf("invalid grids and points outside of the grid\n");
+    return check::expect("accepted", accepted, 0);
+  }
+
+  // positions far outside of the grid, or NaN, get no field
+  bool outside() {
+    const UniformField uniform(ThreeVector(1, 2, 3), ThreeVector(4, 5, 6));
+    GriddedField gridded(ThreeVector(), 1, 3, 3, 3);
+    gridded.sample(uniform);
+
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double x[] = {nan, 1e300, -1e300, inf, -inf, 2.5, 1, 2};
+    const int k = sizeof(x)/sizeof(x[0]);
+    const std::vector<double> y(k, 1), z(k, 1);
+    std::vector<double> f(6*k);
+    gridded.evaluate(k, x, &y[0], &z[0], 0, &f[0], &f[k], &f[2*k], &f[3*k],
+                     &f[4*k], &f[5*k]);
+
+    // the last two points are inside, on a grid plane and on the last one
+    double outsideField = 0, insideError = 0;
+    for (int i = 0; i < k; i++)
+      for (int j = 0; j < 6; j++) {
+        if (i < k-2)
+          outsideField = std::max(outsideField, std::fabs(f[j*k + i]));
+        else
+          insideError = std::max(insideError, std::fabs(f[j*k + i] - j - 1));
+      }
+
+    std::printf("gridded field outside of the grid\n");
+    const bool ok = check::expect("field outside", outsideField, 0);
+    return check::expect("field on the grid planes", insideError, 1e-15)
+           && ok;
+  }
+
+}
+
+int main() {
+  bool ok = gyration();
+  ok = ultrarelativistic() && ok;
+  ok = changedVelocity() && ok;
+  ok = drift() && ok;
+  ok = outside() && ok;
+  ok = invalidGrids() && ok;
+  return ok ? 0 : 1;
+}
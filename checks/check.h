@@ -0,0 +1,70 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdio>
+
+// Helpers of the check programs. Each check compares a fast method with
+// the naive one, prints the errors and timings and exits with status 1 if
+// an error is above its limit, so that ctest catches regressions.
+namespace check {
+
+  // SplitMix64, so that every platform gets the same particles
+  class Random {
+    protected:
+      unsigned long long state;
+
+    public:
+      inline Random(unsigned long long seed = 1) : state(seed) {}
+
+      inline unsigned long long next() {
+        unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+      }
+
+      // in [a, b)
+      inline double uniform(double a = 0, double b = 1) {
+        return a + (b - a)*(next() >> 11)*(1.0/9007199254740992.0);
+      }
+  };
+
+  // wall clock time in seconds
+  inline double seconds() {
+    timeval t;
+    gettimeofday(&t, 0);
+    return t.tv_sec + 1e-6*t.tv_usec;
+  }
+
+  // prints the error and returns whether it is within limit (NaN fails)
+  inline bool expect(const char* what, double error, double limit) {
+    const bool ok = error <= limit;
+    std::printf("  %-44s %10.3e (limit %.1e) %s\n", what, error, limit,
+                ok ? "ok" : "FAILED");
+    return ok;
+  }
+
+} // namespace check
+
+#endif // CHECK_H
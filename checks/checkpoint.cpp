@@ -0,0 +1,317 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Checkpoint against the run it saves: every checkpoint, full or delta,
+// has to restore the particles and the run state bit for bit, and a run
+// restarted from the latest one has to continue exactly like the run
+// that was never interrupted. A flipped byte or a truncated file must
+// make the restore fail and leave the particles alone, and a write that
+// failed must be reported by wait() even if others succeeded after it.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bps_checkpoint.h"
+#include "bps_constants.h"
+#include "bps_particle-array.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const int n = 2000;
+  const int steps = 10;
+  const int baseInterval = 4;
+  const double dt = 1e-3;
+
+  std::vector<double> ParticleArray::* const arrays[] = {
+    &ParticleArray::x, &ParticleArray::y, &ParticleArray::z,
+    &ParticleArray::vx, &ParticleArray::vy, &ParticleArray::vz,
+    &ParticleArray::dvx, &ParticleArray::dvy, &ParticleArray::dvz,
+    &ParticleArray::mass, &ParticleArray::charge
+  };
+
+  ParticleArray particles() {
+    check::Random random(17);
+    ParticleArray a(n);
+    for (int i = 0; i < n; i++) {
+      a.x[i] = random.uniform(-1, 1);
+      a.y[i] = random.uniform(-1, 1);
+      a.z[i] = random.uniform(-1, 1);
+      a.vx[i] = random.uniform(-1, 1);
+      a.vy[i] = random.uniform(-1, 1);
+      a.vz[i] = random.uniform(-1, 1);
+      a.mass[i] = random.uniform(1, 2);
+      a.charge[i] = i % 2 ? 1 : -1;
+    }
+    return a;
+  }
+
+  // a harmonic trap, with a state word that changes every step
+  void step(ParticleArray& a, RunState& s) {
+    for (int i = 0; i < n; i++) {
+      a.dvx[i] = -a.x[i]/a.mass[i]*dt;
+      a.dvy[i] = -a.y[i]/a.mass[i]*dt;
+      a.dvz[i] = -a.z[i]/a.mass[i]*dt;
+    }
+    a.updatePositions(dt);
+    s.step++;
+    s.time += s.dt;
+    s.words[1] = s.words[1]*6364136223846793005ULL + 1442695040888963407ULL;
+  }
+
+  RunState start() {
+    RunState s;
+    s.dt = dt;
+    s.words.push_back(42);
+    s.words.push_back(1);
+    return s;
+  }
+
+  // words that differ, or -1 for different sizes
+  int differences(const ParticleArray& a, const ParticleArray& b) {
+    if (a.size() != b.size()) return -1;
+    int count = 0;
+    for (int k = 0; k < 11; k++)
+      for (int i = 0; i < a.size(); i++)
+        count += (a.*arrays[k])[i] != (b.*arrays[k])[i];
+    return count;
+  }
+
+  int differences(const RunState& a, const RunState& b) {
+    return (a.step != b.step) + (a.time != b.time) + (a.dt != b.dt)
+           + (a.words != b.words);
+  }
+
+  std::string fileName(const std::string& prefix, const int sequence) {
+    char number[32];
+    std::sprintf(number, "-%06d.ckpt", sequence);
+    return prefix + number;
+  }
+
+  long fileSize(const std::string& name) {
+    struct stat s;
+    return stat(name.c_str(), &s) == 0 ? s.st_size : -1;
+  }
+
+  void removeFiles(const std::string& prefix) {
+    for (int q = 0; q <= steps; q++) {
+      std::remove(fileName(prefix, q).c_str());
+      std::remove((fileName(prefix, q) + ".tmp").c_str());
+    }
+    std::remove((prefix + ".index").c_str());
+    std::remove((prefix + ".index.tmp").c_str());
+  }
+
+  // the byte at position of the file XOR 0x10; false if it cannot
+  bool flip(const std::string& name, const long position) {
+    std::FILE* f = std::fopen(name.c_str(), "r+b");
+    if (!f) return false;
+    int byte = -1;
+    if (std::fseek(f, position, SEEK_SET) == 0) byte = std::fgetc(f);
+    const bool ok = byte >= 0 && std::fseek(f, position, SEEK_SET) == 0
+                    && std::fputc(byte ^ 0x10, f) >= 0;
+    return std::fclose(f) == 0 && ok;
+  }
+
+  bool copy(const std::string& from, const std::string& to, const long size) {
+    std::FILE* in = std::fopen(from.c_str(), "rb");
+    std::FILE* out = std::fopen(to.c_str(), "wb");
+    bool ok = in && out;
+    for (long i = 0; ok && i < size; i++) {
+      const int c = std::fgetc(in);
+      ok = c >= 0 && std::fputc(c, out) >= 0;
+    }
+    if (in) std::fclose(in);
+    if (out) ok = std::fclose(out) == 0 && ok;
+    return ok;
+  }
+
+  bool restart(const std::string& prefix) {
+    ParticleArray a = particles();
+    RunState s = start();
+    std::vector<ParticleArray> saved;
+    std::vector<RunState> states;
+    int failedWrites = 0, restoreErrors = 0, fullSize = 0, deltaSize = 0;
+    double tWrite = 0;
+
+    Checkpoint checkpoint(prefix, baseInterval);
+    for (int t = 0; t < steps; t++) {
+      double start = check::seconds();
+      checkpoint.write(a, s);
+      tWrite += check::seconds() - start;
+      saved.push_back(a);
+      states.push_back(s);
+
+      // the particles may change while the checkpoint is written
+      step(a, s);
+      failedWrites += !checkpoint.wait();
+
+      ParticleArray r;
+      RunState q;
+      if (!Checkpoint::restore(prefix, r, q) ||
+          differences(r, saved[t]) != 0 || differences(q, states[t]) != 0)
+        restoreErrors++;
+
+      const long size = fileSize(fileName(prefix, t));
+      if (t == 0) fullSize = size;
+      if (t == 1) deltaSize = size;
+    }
+
+    // the full checkpoints 0, 4 and 8 each replaced the one before
+    int files = 0;
+    for (int q = 0; q < steps; q++)
+      files += fileSize(fileName(prefix, q)) >= 0;
+
+    // restarted from the latest checkpoint (a delta) on a new object; it
+    // is one step behind
+    ParticleArray r;
+    RunState q;
+    const bool restored = Checkpoint::restore(prefix, r, q);
+    Checkpoint again(prefix, baseInterval);
+    const bool numbered = again.getSequence() == steps;
+    step(r, q);
+    for (int t = 0; t < 5; t++) {
+      step(a, s);
+      step(r, q);
+    }
+
+    std::printf("%d particles, %d checkpoints, a full one every %d: full"
+                " %d bytes, delta %d bytes, write() %.1f ms\n", n, steps,
+                baseInterval, fullSize, deltaSize, 1e3*tWrite/steps);
+    bool ok = check::expect("failed writes", failedWrites, 0);
+    ok = check::expect("checkpoints restored differently", restoreErrors, 0)
+         && ok;
+    ok = check::expect("files left - 2", std::abs(files - 2), 0) && ok;
+    ok = check::expect("wrong sequence after restart", !numbered, 0) && ok;
+    ok = check::expect("restart failed", !restored, 0) && ok;
+    ok = check::expect("words differing after restart",
+                       differences(r, a) + differences(q, s), 0) && ok;
+    return check::expect("delta / full size", deltaSize/(1.0*fullSize), 0.8)
+           && ok;
+  }
+
+  // restore of prefix has to fail and leave the particles alone
+  int accepted(const std::string& prefix) {
+    ParticleArray a = particles(), b = a;
+    RunState s = start(), t = s;
+    const bool restored = Checkpoint::restore(prefix, a, s);
+    return restored || differences(a, b) != 0 || differences(s, t) != 0;
+  }
+
+  bool corruption(const std::string& prefix) {
+    // the files of the last run: full checkpoint 8 and delta 9
+    const std::string base = fileName(prefix, 8), delta = fileName(prefix, 9);
+    const long baseSize = fileSize(base), deltaSize = fileSize(delta);
+    const std::string savedBase = prefix + "-base", savedDelta = prefix
+                                                               + "-delta";
+    bool ok = copy(base, savedBase, baseSize)
+              && copy(delta, savedDelta, deltaSize);
+
+    // bytes in the header, the state, the particles and the checksum
+    const long positions[] = {0, 30, 60, baseSize/2, baseSize - 1};
+    int accepts = 0, cases = 0;
+    for (int k = 0; ok && k < 5; k++) {
+      for (int f = 0; ok && f < 2; f++) {
+        const std::string& name = f == 0 ? base : delta;
+        const long position = f == 0 ? positions[k]
+                              : positions[k]*deltaSize/baseSize;
+        ok = flip(name, position);
+        accepts += accepted(prefix);
+        cases++;
+        ok = ok && flip(name, position);
+      }
+    }
+    ok = ok && check::expect("restore failed with the original files",
+                             !accepted(prefix), 0);
+
+    // truncated by one byte and to half
+    for (int f = 0; ok && f < 2; f++) {
+      const std::string& name = f == 0 ? base : delta;
+      const std::string& original = f == 0 ? savedBase : savedDelta;
+      const long size = f == 0 ? baseSize : deltaSize;
+      for (int k = 0; ok && k < 2; k++) {
+        ok = copy(original, name, k == 0 ? size - 1 : size/2);
+        accepts += accepted(prefix);
+        cases++;
+      }
+      ok = ok && copy(original, name, size);
+    }
+    std::remove(savedBase.c_str());
+    std::remove(savedDelta.c_str());
+
+    std::printf("%d corrupted or truncated checkpoints\n", cases);
+    ok = check::expect("files could not be changed", !ok, 0) && ok;
+    return check::expect("corrupted checkpoints restored", accepts, 0) && ok;
+  }
+
+  // the first write cannot create its file, the second one (which waits
+  // for the first) neither, the third one can
+  bool failure(const std::string& directory) {
+    const std::string later = directory + "/later";
+    const std::string prefix = later + "/run";
+    const ParticleArray a = particles();
+    const RunState s = start();
+
+    Checkpoint checkpoint(prefix, baseInterval);
+    checkpoint.write(a, s).write(a, s);
+    const bool created = mkdir(later.c_str(), 0700) == 0;
+    checkpoint.write(a, s);
+    const bool first = checkpoint.wait();
+    checkpoint.write(a, s);
+    const bool second = checkpoint.wait();
+
+    ParticleArray r;
+    RunState q;
+    const bool restored = Checkpoint::restore(prefix, r, q)
+                          && differences(r, a) == 0;
+    removeFiles(prefix);
+    rmdir(later.c_str());
+
+    std::printf("a failed write followed by successful ones\n");
+    bool ok = check::expect("directory not created", !created, 0);
+    ok = check::expect("failure not reported", first, 0) && ok;
+    ok = check::expect("reported again", !second, 0) && ok;
+    return check::expect("later checkpoint lost", !restored, 0) && ok;
+  }
+
+} // namespace
+
+int main() {
+  char directory[] = "/tmp/bps-checkpoint-XXXXXX";
+  if (!mkdtemp(directory)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  const std::string prefix = std::string(directory) + "/run";
+
+  bool ok = restart(prefix);
+  ok = corruption(prefix) && ok;
+  ok = failure(directory) && ok;
+
+  removeFiles(prefix);
+  rmdir(directory);
+  return ok ? 0 : 1;
+}
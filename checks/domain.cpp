@@ -0,0 +1,200 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Screened Coloumb dynamics on a domain decomposition against the same
+// run in a single process, in an open and in a periodic box. Run it on
+// several MPI ranks, e.g. mpiexec -n 4 check_domain.
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_domain.h"
+#include "bps_mpi-communicator.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  // few steps: the dynamics are chaotic, so the rounding differences of
+  // another summation order grow exponentially
+  const int n = 2000, steps = 20;
+  const double length = 10, debye = 1, cutoff = 2.5, skin = 0.5;
+  const double dt = 1e-3, q0 = 1e-5, tag = 1e-9;
+
+  // the index of a particle is encoded in its charge, so it can be found
+  // on whatever rank it ends up
+  std::vector<Particle> particles() {
+    check::Random random(11);
+    std::vector<Particle> p(n);
+    for (int i = 0; i < n; i++) {
+      for (int d = 0; d < 3; d++) {
+        p[i].position[d] = random.uniform(0, length);
+        p[i].velocity[d] = random.uniform(-2, 2);
+      }
+      p[i].mass = 1;
+      p[i].charge = (i % 2 ? 1 : -1)*q0*(1 + i*tag);
+    }
+    return p;
+  }
+
+  int index(const Particle& p) {
+    return static_cast<int>(std::floor((std::fabs(p.charge)/q0 - 1)/tag
+                                       + 0.5));
+  }
+
+  void step(std::vector<Particle>& p, const PeriodicBox& box) {
+    for (unsigned i = 0; i < p.size(); i++) {
+      p[i].updatePosition(dt, box);
+      p[i].dv.set(0, 0, 0);
+    }
+  }
+
+  // indices of the particles of this rank and of its ghosts, in the order
+  // the force sees them
+  std::vector<int> members(const DomainDecomposition& domains,
+                           const std::vector<Particle>& p) {
+    std::vector<Particle> ghosts;
+    domains.exchangeHalo(p, cutoff + skin, ghosts);
+    std::vector<int> m;
+    for (unsigned i = 0; i < p.size(); i++)
+      m.push_back(index(p[i]));
+    for (unsigned i = 0; i < ghosts.size(); i++)
+      m.push_back(index(ghosts[i]));
+    return m;
+  }
+
+  // positions and velocities of all ranks by particle index
+  std::vector<double> gather(const Communicator& comm,
+                             const std::vector<Particle>& p) {
+    std::vector<double> state(6*n, 0);
+    for (unsigned i = 0; i < p.size(); i++) {
+      const int k = index(p[i]);
+      for (int d = 0; d < 3; d++) {
+        state[6*k + d] = p[i].position[d];
+        state[6*k + 3 + d] = p[i].velocity[d];
+      }
+    }
+    comm.sum(&state[0], state.size());
+    return state;
+  }
+
+  bool compare(const Communicator& comm, const PeriodicBox& box,
+               const char* name) {
+    // reference: all particles in this process
+    std::vector<Particle> serial = particles();
+    ScreenedColoumbForce serialForce(debye, cutoff, skin, box);
+    for (int s = 0; s < steps; s++) {
+      serialForce.apply(serial, dt);
+      step(serial, box);
+    }
+
+    std::vector<Particle> local;
+    const std::vector<Particle> all = particles();
+    for (int i = comm.rank(); i < n; i += comm.size())
+      local.push_back(all[i]);
+
+    DomainDecomposition domains(comm, box);
+    domains.partition(local);
+    ScreenedColoumbForce force(debye, cutoff, skin, box);
+
+    // The particles move less than skin/2 in all steps, so the Verlet
+    // list has to be rebuilt exactly when the members of some rank change.
+    std::vector<int> previous;
+    int changes = 0;
+    double t = 0;
+    for (int s = 0; s < steps; s++) {
+      const std::vector<int> current = members(domains, local);
+      double changed = current != previous ? 1 : 0;
+      comm.max(&changed, 1);
+      if (changed != 0) changes++;
+      previous = current;
+
+      const double t0 = check::seconds();
+      domains.screenedColoumbForce(local, force, dt);
+      step(local, box);
+      domains.migrate(local);
+      t += check::seconds() - t0;
+    }
+    double builds = force.neighbourList().buildCount();
+    comm.max(&builds, 1);
+
+    double count = local.size();
+    comm.sum(&count, 1);
+    const std::vector<double> state = gather(comm, local);
+    double position = 0, velocity = 0;
+    for (int k = 0; k < n; k++) {
+      const int i = index(serial[k]);
+      for (int d = 0; d < 3; d++) {
+        const double dx = state[6*i + d] - serial[k].position[d];
+        const double dv = state[6*i + 3 + d] - serial[k].velocity[d];
+        position = std::max(position, std::fabs(box.minimumImage(dx, d)));
+        velocity = std::max(velocity, std::fabs(dv));
+      }
+    }
+
+    if (comm.rank() != 0) return true;
+    std::printf("%s, %d particles on %d ranks, %d steps: %.3f s, members"
+                " changed in %d steps\n", name, n, comm.size(), steps, t,
+                changes);
+    bool ok = check::expect("particles lost or duplicated",
+                            std::fabs(count - n), 0);
+    ok = check::expect("Verlet builds - steps with changed members",
+                       std::fabs(builds - changes), 0) && ok;
+    ok = check::expect("max |x - x_serial|", position, 1e-12) && ok;
+    return check::expect("max |v - v_serial|", velocity, 1e-12) && ok;
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  MpiCommunicator comm;
+
+  bool ok = compare(comm, PeriodicBox(), "open box");
+  ok = compare(comm, PeriodicBox(length, length, length), "periodic box")
+       && ok;
+
+  // a force in another box than the decomposition is rejected
+  bool thrown = false;
+  try {
+    std::vector<Particle> p;
+    ScreenedColoumbForce force(debye, cutoff, skin,
+                               PeriodicBox(length, length, length));
+    DomainDecomposition(comm).screenedColoumbForce(p, force, dt);
+  } catch (std::invalid_argument&) {
+    thrown = true;
+  }
+  if (comm.rank() == 0)
+    ok = check::expect("mismatched box accepted",
+                       thrown ? 0 : 1, 0) && ok;
+
+  // every rank exits with the result of rank 0
+  double failed = comm.rank() == 0 && !ok ? 1 : 0;
+  comm.sum(&failed, 1);
+  MPI_Finalize();
+  return failed != 0 ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Particle-mesh Ewald Coloumb forces against a converged direct Ewald sum
+// of the same neutral, periodic system, for several B-spline orders, and
+// the rejection of invalid parameters. Errors are relative to the RMS of
+// the exact dv.
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_ewald.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double length = 10, dt = 1;
+
+  std::vector<Particle> particles(int n) {
+    check::Random random(5);
+    std::vector<Particle> p(n);
+    for (int i = 0; i < n; i++) {
+      for (int d = 0; d < 3; d++)
+        p[i].position[d] = random.uniform(0, length);
+      p[i].mass = 1;
+      p[i].charge = (i % 2 ? 1 : -1)*1e-6;
+    }
+    return p;
+  }
+
+  // Ewald sum with its own splitting parameter: the real space sum over
+  // the 27 nearest images of every pair is truncated at erfc(alpha L) and
+  // the reciprocal sum at exp(-(pi M/(alpha L))^2), both below 1e-11.
+  void directEwald(std::vector<Particle>& p) {
+    const int n = p.size();
+    const double alpha = 0.5;
+    const int M = 12;
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const double volume = length*length*length;
+
+    for (int i = 0; i < n; i++) {
+      double f[3] = {0, 0, 0};
+      for (int j = 0; j < n; j++) {
+        if (j == i) continue;
+        for (int a = -1; a <= 1; a++)
+          for (int b = -1; b <= 1; b++)
+            for (int c = -1; c <= 1; c++) {
+              const double r[3] = {
+                p[i].position[0] - p[j].position[0] + a*length,
+                p[i].position[1] - p[j].position[1] + b*length,
+                p[i].position[2] - p[j].position[2] + c*length
+              };
+              const double l_square = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+              const double l = std::sqrt(l_square);
+              const double g = p[j].charge
+                               *(erfc(alpha*l)/l + 2*alpha/std::sqrt(M_PI)
+                                 *std::exp(-alpha*alpha*l_square))/l_square;
+              for (int d = 0; d < 3; d++)
+                f[d] += g*r[d];
+            }
+      }
+      for (int d = 0; d < 3; d++)
+        p[i].dv[d] = dt/p[i].mass*k*p[i].charge*f[d];
+    }
+
+    // structure factor S(m) = sum_j q_j exp(i k.r_j) per wave vector
+    for (int a = -M; a <= M; a++)
+      for (int b = -M; b <= M; b++)
+        for (int c = -M; c <= M; c++) {
+          if (a == 0 && b == 0 && c == 0) continue;
+          const double kv[3] = {2*M_PI*a/length, 2*M_PI*b/length,
+                                2*M_PI*c/length};
+          const double k_square = kv[0]*kv[0] + kv[1]*kv[1] + kv[2]*kv[2];
+          const double weight = 4*M_PI/volume/k_square
+                                *std::exp(-k_square/(4*alpha*alpha));
+          if (weight < 1e-30) continue;
+
+          std::vector<double> phase(n);
+          double re = 0, im = 0;
+          for (int j = 0; j < n; j++) {
+            phase[j] = kv[0]*p[j].position[0] + kv[1]*p[j].position[1]
+                       + kv[2]*p[j].position[2];
+            re += p[j].charge*std::cos(phase[j]);
+            im += p[j].charge*std::sin(phase[j]);
+          }
+          for (int i = 0; i < n; i++) {
+            const double s = weight*(re*std::sin(phase[i])
+                                     - im*std::cos(phase[i]));
+            for (int d = 0; d < 3; d++)
+              p[i].dv[d] += dt/p[i].mass*k*p[i].charge*s*kv[d];
+          }
+        }
+  }
+
+  // RMS of |dv - dv_exact| relative to the RMS of dv_exact
+  double rmsError(const std::vector<Particle>& p,
+                  const std::vector<Particle>& exact) {
+    double error = 0, scale = 0;
+    for (unsigned i = 0; i < p.size(); i++) {
+      error += (p[i].dv - exact[i].dv)*(p[i].dv - exact[i].dv);
+      scale += exact[i].dv*exact[i].dv;
+    }
+    return std::sqrt(error/scale);
+  }
+
+  bool compare(const std::vector<Particle>& exact, const double cutoff,
+               const double accuracy, const int order, const double limit) {
+    std::vector<Particle> p = exact;
+    for (unsigned i = 0; i < p.size(); i++)
+      p[i].dv = ThreeVector(0, 0, 0);
+
+    ParticleMeshEwald pme(PeriodicBox(length, length, length), cutoff,
+                          accuracy, order);
+    const double t = check::seconds();
+    pme.coloumbForce(p, dt);
+    const double tMesh = check::seconds() - t;
+
+    std::printf("order %d, accuracy %.0e, %d^3 grid: %.4f s\n", order,
+                accuracy, pme.gridSize(0), tMesh);
+    return check::expect("RMS relative error", rmsError(p, exact), limit);
+  }
+
+  // whether the constructor throws std::invalid_argument
+  bool rejects(const PeriodicBox& box, const double cutoff,
+               const int order) {
+    try {
+      ParticleMeshEwald pme(box, cutoff, 1e-5, order);
+    } catch (std::invalid_argument&) {
+      return true;
+    }
+    return false;
+  }
+
+}
+
+int main() {
+  std::vector<Particle> exact = particles(200);
+  for (unsigned i = 0; i < exact.size(); i++)
+    exact[i].dv = ThreeVector(0, 0, 0);
+  const double t = check::seconds();
+  directEwald(exact);
+  std::printf("direct Ewald sum, %d particles: %.4f s\n",
+              static_cast<int>(exact.size()), check::seconds() - t);
+
+  bool ok = true;
+  ok = compare(exact, 4, 1e-5, 4, 1e-3) && ok;
+  ok = compare(exact, 4, 1e-5, 6, 1e-4) && ok;
+  ok = compare(exact, 4, 1e-8, 8, 1e-5) && ok;
+
+  const PeriodicBox box(length, length, length);
+  ok = check::expect("order 1 accepted", !rejects(box, 4, 1), 0) && ok;
+  ok = check::expect("order maxOrder + 1 accepted",
+                     !rejects(box, 4, ParticleMeshEwald::maxOrder + 1), 0)
+       && ok;
+  ok = check::expect("open box accepted",
+                     !rejects(PeriodicBox(length, length, 0), 4, 4), 0) && ok;
+  ok = check::expect("cutoff beyond L/2 accepted", !rejects(box, 5, 4), 0)
+       && ok;
+  ok = check::expect("valid parameters rejected", rejects(box, 4, 4), 0)
+       && ok;
+  return ok ? 0 : 1;
+}
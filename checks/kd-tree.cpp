@@ -0,0 +1,171 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// KdTree queries against brute force over all points: radius and k
+// nearest neighbour queries, single and batched, after a build and after
+// a refit to moved points, for 10^4 to 10^7 points. Prints the times per
+// query of both; fewer queries are compared for the larger sizes, so
+// that brute force stays within seconds.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_kd-tree.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const int k = 16;
+
+  double distanceSquare(const ThreeVector& a, const ThreeVector& b) {
+    const ThreeVector d = a - b;
+    return d*d;
+  }
+
+  void bruteRadius(const std::vector<ThreeVector>& points,
+                   const ThreeVector& center, const double r,
+                   std::vector<int>& result) {
+    const int n = points.size();
+    result.clear();
+    for (int i = 0; i < n; i++)
+      if (distanceSquare(points[i], center) <= r*r) result.push_back(i);
+  }
+
+  // distances of the k nearest points, nearest first
+  void bruteNearest(const std::vector<ThreeVector>& points,
+                    const ThreeVector& center, std::vector<double>& result) {
+    const int n = points.size();
+    std::vector<double> all(n);
+    for (int i = 0; i < n; i++)
+      all[i] = distanceSquare(points[i], center);
+    std::partial_sort(all.begin(), all.begin() + k, all.end());
+    result.resize(k);
+    for (int i = 0; i < k; i++)
+      result[i] = std::sqrt(all[i]);
+  }
+
+  // counts the centers where the tree differs from brute force; nearest
+  // neighbours are compared by distance, which ignores ties
+  bool compare(const KdTree& tree, const std::vector<ThreeVector>& points,
+               const std::vector<ThreeVector>& centers, const double r,
+               const char* name) {
+    const int n = points.size();
+    const int queries = centers.size();
+    std::vector<int> expected, found, offsets, batch;
+    std::vector<std::vector<double> > exact(queries);
+    std::vector<double> distances;
+    int radiusErrors = 0, nearestErrors = 0, batchErrors = 0;
+    double tBrute = 0, tRadius = 0, tNearest = 0;
+
+    tree.radius(centers, r, offsets, batch);
+    for (int q = 0; q < queries; q++) {
+      double t = check::seconds();
+      bruteRadius(points, centers[q], r, expected);
+      bruteNearest(points, centers[q], exact[q]);
+      tBrute += check::seconds() - t;
+
+      t = check::seconds();
+      tree.radius(centers[q], r, found);
+      tRadius += check::seconds() - t;
+      std::sort(found.begin(), found.end());
+      if (found != expected) radiusErrors++;
+
+      std::vector<int> fromBatch(batch.begin() + offsets[q],
+                                 batch.begin() + offsets[q+1]);
+      std::sort(fromBatch.begin(), fromBatch.end());
+      if (fromBatch != expected) batchErrors++;
+
+      t = check::seconds();
+      tree.nearest(centers[q], k, found, distances);
+      tNearest += check::seconds() - t;
+      bool same = static_cast<int>(found.size()) == k;
+      for (int i = 0; same && i < k; i++)
+        same = std::fabs(distances[i] - exact[q][i]) <= 1e-15 &&
+               std::fabs(std::sqrt(distanceSquare(points[found[i]],
+                                                  centers[q])) - exact[q][i])
+               <= 1e-15;
+      if (!same) nearestErrors++;
+    }
+
+    tree.nearest(centers, k, batch);
+    for (int q = 0; q < queries; q++) {
+      for (int i = 0; i < k; i++) {
+        const int j = batch[k*q + i];
+        if (j < 0 || std::fabs(std::sqrt(distanceSquare(points[j],
+                                                        centers[q]))
+                               - exact[q][i]) > 1e-15) {
+          batchErrors++;
+          break;
+        }
+      }
+    }
+
+    // the ratio depends on the machine and its load, so it is not checked
+    std::printf("%s, %d points, %d queries, k = %d: brute force %.1f us,"
+                " radius %.1f us, nearest %.1f us per query, tree / brute"
+                " force time %.2g\n", name, n, queries, k,
+                1e6*tBrute/queries, 1e6*tRadius/queries,
+                1e6*tNearest/queries, (tRadius + tNearest)/tBrute);
+    bool ok = check::expect("radius queries differing", radiusErrors, 0);
+    ok = check::expect("nearest queries differing", nearestErrors, 0) && ok;
+    return check::expect("batched queries differing", batchErrors, 0) && ok;
+  }
+
+  bool compare(const int n, check::Random& random) {
+    // about 2 10^7 brute force distances per stage, at least 4 queries
+    const int queries = std::max(4, std::min(200, 20000000/n));
+    std::vector<ThreeVector> points(n), centers(queries);
+    for (int i = 0; i < n; i++)
+      points[i].set(random.uniform(), random.uniform(), random.uniform());
+    for (int q = 0; q < queries; q++)
+      centers[q].set(random.uniform(), random.uniform(), random.uniform());
+
+    // about 30 points per radius query
+    const double r = std::pow(30*3/(4*M_PI*n), 1.0/3);
+
+    KdTree tree;
+    double t = check::seconds();
+    tree.build(points);
+    std::printf("%d points: build %.4f s\n", n, check::seconds() - t);
+    bool ok = compare(tree, points, centers, r, "after build");
+
+    // moves of a few mean spacings
+    const double move = 0.05*std::pow(1e5/n, 1.0/3);
+    for (int i = 0; i < n; i++)
+      for (int d = 0; d < 3; d++)
+        points[i][d] += random.uniform(-move, move);
+    t = check::seconds();
+    tree.refit(points);
+    std::printf("%d points: refit %.4f s\n", n, check::seconds() - t);
+    return compare(tree, points, centers, r, "after refit") && ok;
+  }
+
+}
+
+int main() {
+  check::Random random(13);
+  bool ok = true;
+  for (int n = 10000; n <= 10000000; n *= 10)
+    ok = compare(n, random) && ok;
+  return ok ? 0 : 1;
+}
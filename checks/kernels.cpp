@@ -0,0 +1,268 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Every kernel table the CPU supports against the generic (scalar) one,
+// switched with Kernels::select, on the same inputs. The vectorized loops
+// may contract to FMA and reorder the pair sums, so the results agree to
+// rounding only. If BPS_SIMD_LEVEL is set, the level selected at load
+// time has to respect it.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_kernels.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  // not a multiple of any vector width, so the remainder loops run too
+  const int n = 1001;
+
+  const int kernelCount = 9;
+  const char* kernelNames[kernelCount] = {
+    "axpy", "scale", "pairField", "addVelocities", "rotate", "transform4",
+    "boostVelocities", "borisPush", "rotateBodies"
+  };
+
+  std::vector<double> values(check::Random& random, double a, double b) {
+    std::vector<double> v(n);
+    for (int i = 0; i < n; i++)
+      v[i] = random.uniform(a, b);
+    return v;
+  }
+
+  void append(std::vector<double>& out, const std::vector<double>& v) {
+    out.insert(out.end(), v.begin(), v.end());
+  }
+
+  // Lorentz matrix (row-major, on (ct, x, y, z)) into the frame moving
+  // with velocity beta c
+  void boostMatrix(const double beta[3], double m[16]) {
+    const double b_square = beta[0]*beta[0] + beta[1]*beta[1]
+                            + beta[2]*beta[2];
+    const double gamma = 1/std::sqrt(1 - b_square);
+    m[0] = gamma;
+    for (int i = 0; i < 3; i++) {
+      m[1+i] = m[4*(i+1)] = -gamma*beta[i];
+      for (int j = 0; j < 3; j++)
+        m[4*(i+1)+1+j] = (i == j ? 1 : 0)
+                         + (gamma - 1)*beta[i]*beta[j]/b_square;
+    }
+  }
+
+  // outputs of every kernel of t for the same inputs
+  void run(const Kernels::Table& t, std::vector<double> out[kernelCount]) {
+    const double c = BPS_CONST_SPEED_OF_LIGHT;
+    check::Random random(11);
+    for (int k = 0; k < kernelCount; k++)
+      out[k].clear();
+
+    const std::vector<double> x = values(random, -1, 1);
+    const std::vector<double> y = values(random, -1, 1);
+    const std::vector<double> z = values(random, -1, 1);
+
+    std::vector<double> a = y;
+    t.axpy(n, 0.3, &x[0], &a[0]);
+    append(out[0], a);
+
+    a = x;
+    t.scale(n, -1.7, &a[0]);
+    append(out[1], a);
+
+    // a quarter of the points as targets of all of them
+    const std::vector<double> s = values(random, -1, 1);
+    std::vector<double> fx(n/4, 0), fy(n/4, 0), fz(n/4, 0);
+    t.pairField(n, &x[0], &y[0], &z[0], &s[0], n/2, n/2 + n/4, &fx[0],
+                &fy[0], &fz[0]);
+    append(out[2], fx);
+    append(out[2], fy);
+    append(out[2], fz);
+
+    // speeds below c/2
+    const double v = 0.5*c/std::sqrt(3.0);
+    std::vector<double> vx = values(random, -v, v);
+    std::vector<double> vy = values(random, -v, v);
+    std::vector<double> vz = values(random, -v, v);
+    const std::vector<double> dvx = values(random, -v, v);
+    const std::vector<double> dvy = values(random, -v, v);
+    const std::vector<double> dvz = values(random, -v, v);
+    std::vector<double> wx = vx, wy = vy, wz = vz;
+    t.addVelocities(n, &wx[0], &wy[0], &wz[0], &dvx[0], &dvy[0], &dvz[0]);
+    append(out[3], wx);
+    append(out[3], wy);
+    append(out[3], wz);
+
+    // rotation by 0.7 about z, then by -1.1 about x
+    const double c1 = std::cos(0.7), s1 = std::sin(0.7);
+    const double c2 = std::cos(-1.1), s2 = std::sin(-1.1);
+    const double m[9] = {c1, -s1, 0, c2*s1, c2*c1, -s2, s2*s1, s2*c1, c2};
+    std::vector<double> rx = x, ry = y, rz = z;
+    t.rotate(n, m, &rx[0], &ry[0], &rz[0]);
+    append(out[4], rx);
+    append(out[4], ry);
+    append(out[4], rz);
+
+    const double beta[3] = {0.3, -0.4, 0.5};
+    double boost[16];
+    boostMatrix(beta, boost);
+    std::vector<double> a0 = values(random, 1, 2);
+    rx = x;
+    ry = y;
+    rz = z;
+    t.transform4(n, boost, &a0[0], &rx[0], &ry[0], &rz[0]);
+    append(out[5], a0);
+    append(out[5], rx);
+    append(out[5], ry);
+    append(out[5], rz);
+
+    wx = vx;
+    wy = vy;
+    wz = vz;
+    t.boostVelocities(n, boost, &wx[0], &wy[0], &wz[0]);
+    append(out[6], wx);
+    append(out[6], wy);
+    append(out[6], wz);
+
+    // electrons and positrons in strong fields, every tenth one massless
+    std::vector<double> charge(n), mass(n);
+    for (int i = 0; i < n; i++) {
+      charge[i] = (i % 2 ? 1 : -1)*BPS_CONST_ELEMENTARY_CHARGE;
+      mass[i] = i % 10 ? BPS_CONST_MASS_ELECTRON : 0;
+    }
+    const std::vector<double> ex = values(random, -1e6, 1e6);
+    const std::vector<double> ey = values(random, -1e6, 1e6);
+    const std::vector<double> ez = values(random, -1e6, 1e6);
+    const std::vector<double> bx = values(random, -1, 1);
+    const std::vector<double> by = values(random, -1, 1);
+    const std::vector<double> bz = values(random, -1, 1);
+    rx = x;
+    ry = y;
+    rz = z;
+    std::vector<double> ux = vx, uy = vy, uz = vz;
+    t.borisPush(n, 1e-12, &charge[0], &mass[0], &ex[0], &ey[0], &ez[0],
+                &bx[0], &by[0], &bz[0], &rx[0], &ry[0], &rz[0], &ux[0],
+                &uy[0], &uz[0], &wx[0], &wy[0], &wz[0]);
+    append(out[7], rx);
+    append(out[7], ry);
+    append(out[7], rz);
+    append(out[7], ux);
+    append(out[7], uy);
+    append(out[7], uz);
+    append(out[7], wx);
+    append(out[7], wy);
+    append(out[7], wz);
+
+    // unit quaternions, every tenth body without moment about x
+    std::vector<double> ix = values(random, 1, 3);
+    const std::vector<double> iy = values(random, 1, 3);
+    const std::vector<double> iz = values(random, 1, 3);
+    std::vector<double> q0 = values(random, -1, 1);
+    std::vector<double> q1 = values(random, -1, 1);
+    std::vector<double> q2 = values(random, -1, 1);
+    std::vector<double> q3 = values(random, -1, 1);
+    for (int i = 0; i < n; i++) {
+      const double norm = std::sqrt(q0[i]*q0[i] + q1[i]*q1[i]
+                                    + q2[i]*q2[i] + q3[i]*q3[i]);
+      q0[i] /= norm;
+      q1[i] /= norm;
+      q2[i] /= norm;
+      q3[i] /= norm;
+      if (i % 10 == 0) ix[i] = 0;
+    }
+    std::vector<double> lx = values(random, -1, 1);
+    std::vector<double> ly = values(random, -1, 1);
+    std::vector<double> lz = values(random, -1, 1);
+    t.rotateBodies(n, 0.1, &ix[0], &iy[0], &iz[0], &q0[0], &q1[0], &q2[0],
+                   &q3[0], &lx[0], &ly[0], &lz[0]);
+    append(out[8], q0);
+    append(out[8], q1);
+    append(out[8], q2);
+    append(out[8], q3);
+    append(out[8], lx);
+    append(out[8], ly);
+    append(out[8], lz);
+  }
+
+  // max |a - b| relative to max |b|
+  double relativeError(const std::vector<double>& a,
+                       const std::vector<double>& b) {
+    double error = 0, scale = 0;
+    for (unsigned int i = 0; i < b.size(); i++) {
+      error = std::max(error, std::fabs(a[i] - b[i]));
+      scale = std::max(scale, std::fabs(b[i]));
+    }
+    return error/scale;
+  }
+
+}
+
+int main() {
+  bool ok = true;
+  const Kernels::Level supported = Kernels::supportedLevel();
+  std::printf("supported level %s, selected at load time %s\n",
+              Kernels::levelName(supported),
+              Kernels::levelName(Kernels::level()));
+
+  const char* forced = std::getenv("BPS_SIMD_LEVEL");
+  if (forced != 0) {
+    Kernels::Level expected = supported;
+    for (int l = Kernels::Generic; l <= Kernels::AVX512; l++) {
+      const Kernels::Level level = static_cast<Kernels::Level>(l);
+      if (std::strcmp(forced, Kernels::levelName(level)) == 0)
+        expected = std::min(level, supported);
+    }
+    std::printf("BPS_SIMD_LEVEL=%s\n", forced);
+    ok = check::expect("level differs from BPS_SIMD_LEVEL",
+                       Kernels::level() != expected, 0) && ok;
+  }
+
+  ok = check::expect("generic level not selected",
+                     Kernels::select(Kernels::Generic) != Kernels::Generic,
+                     0) && ok;
+  std::vector<double> reference[kernelCount];
+  run(Kernels::table(), reference);
+
+  for (int l = Kernels::SSE2; l <= Kernels::AVX512; l++) {
+    const Kernels::Level level = static_cast<Kernels::Level>(l);
+    const char* name = Kernels::levelName(level);
+    if (Kernels::select(level) != level) {
+      std::printf("%s: not supported by the CPU or the build, skipped\n",
+                  name);
+      continue;
+    }
+
+    std::vector<double> out[kernelCount];
+    const double t = check::seconds();
+    run(Kernels::table(), out);
+    std::printf("%s: all kernels %.4f s\n", name, check::seconds() - t);
+    for (int k = 0; k < kernelCount; k++) {
+      char what[64];
+      std::sprintf(what, "%s against generic", kernelNames[k]);
+      ok = check::expect(what, relativeError(out[k], reference[k]), 1e-13)
+           && ok;
+    }
+  }
+  return ok ? 0 : 1;
+}
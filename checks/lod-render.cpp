@@ -0,0 +1,266 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The octree renderer of mensor, offscreen through EGL, against drawing
+// every particle with the same matrices: the level-of-detail cut of a
+// clustered snapshot has to cover every particle exactly once and look
+// like the full drawing, and a cut refined down to all leaves has to give
+// the same pixels. Exits with 77 (skipped) without an EGL display.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+
+#include "bps_particle-array.h"
+#include "check.h"
+#include "octree.h"
+#include "octree_renderer.h"
+
+namespace {
+
+  const int side = 512;
+  const int n = 1000000;
+
+  // a pbuffer context with the compatibility profile, preferably without
+  // any window system
+  bool makeContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC platformDisplay =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (platformDisplay)
+      display = platformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                EGL_DEFAULT_DISPLAY, 0);
+    if (display == EGL_NO_DISPLAY)
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0))
+      return false;
+
+    const EGLint attributes[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+      EGL_DEPTH_SIZE, 24, EGL_NONE
+    };
+    EGLConfig config;
+    EGLint count;
+    if (!eglChooseConfig(display, attributes, &config, 1, &count) ||
+        count == 0 || !eglBindAPI(EGL_OPENGL_API))
+      return false;
+
+    const EGLint size[] = {EGL_WIDTH, side, EGL_HEIGHT, side, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, size);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                                          0);
+    return surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT &&
+           eglMakeCurrent(display, surface, surface, context);
+  }
+
+  // Gaussian clusters of widths 0.002 to 0.128 in a uniform background,
+  // with random charges of both signs and neutral particles
+  bps::ParticleArray snapshot() {
+    check::Random random(17);
+    bps::ParticleArray a(n);
+    const int clusters = 20;
+    for (int i = 0; i < n; i++) {
+      const int c = i % (clusters + 1);
+      check::Random centers(100 + c);
+      double r[3];
+      for (int d = 0; d < 3; d++) {
+        if (c == clusters) {
+          r[d] = random.uniform(-1, 1);
+        } else {
+          // Box-Muller around the center of cluster c
+          const double center = centers.uniform(-0.7, 0.7);
+          const double width = 0.002*std::pow(4.0, c % 4);
+          const double u = 1 - random.uniform();
+          r[d] = center + width*std::sqrt(-2*std::log(u))
+                 *std::cos(2*M_PI*random.uniform());
+        }
+      }
+      a.x[i] = r[0];
+      a.y[i] = r[1];
+      a.z[i] = r[2];
+      a.mass[i] = 1;
+      a.charge[i] = static_cast<int>(random.next() % 3) - 1;
+    }
+    return a;
+  }
+
+  void readPixels(std::vector<unsigned char>& image) {
+    image.resize(3*side*side);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, side, side, GL_RGB, GL_UNSIGNED_BYTE, &image[0]);
+  }
+
+  // paints until the cut has converged, returns the number of frames
+  int paint(OctreeRenderer& renderer, const OctreeRenderer::Camera& camera,
+            std::vector<unsigned char>& image, double& seconds) {
+    int frames = 1;
+    const double t = check::seconds();
+    while (!renderer.paint(camera) && frames < 10000)
+      frames++;
+    glFinish();
+    seconds = check::seconds() - t;
+    readPixels(image);
+    return frames;
+  }
+
+  // every particle, with the matrices of the last paint
+  void paintAll(const Octree& tree, std::vector<unsigned char>& image,
+                double& seconds) {
+    const double t = check::seconds();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glVertexPointer(3, GL_FLOAT, 0, &tree.points[0]);
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, &tree.colors[0]);
+    glDrawArrays(GL_POINTS, 0, tree.points.size()/3);
+    glFinish();
+    seconds = check::seconds() - t;
+    readPixels(image);
+  }
+
+  bool isBackground(const unsigned char* p) {
+    return p[0] == 128 && p[1] == 128 && p[2] == 128;
+  }
+
+  // pixels that are background in one image only, and the mean color
+  // difference of the pixels drawn in both, relative to the pixels drawn
+  // in the full image
+  void compare(const std::vector<unsigned char>& a,
+               const std::vector<unsigned char>& b, double& coverage,
+               double& color, int& differing) {
+    int drawn = 0, mismatched = 0, both = 0;
+    double sum = 0;
+    differing = 0;
+    for (int i = 0; i < side*side; i++) {
+      const unsigned char* p = &a[3*i];
+      const unsigned char* q = &b[3*i];
+      if (p[0] != q[0] || p[1] != q[1] || p[2] != q[2]) differing++;
+      if (!isBackground(q)) drawn++;
+      if (isBackground(p) != isBackground(q)) {
+        mismatched++;
+      } else if (!isBackground(p)) {
+        both++;
+        for (int d = 0; d < 3; d++)
+          sum += std::abs(p[d] - q[d])/255.0/3;
+      }
+    }
+    coverage = drawn > 0 ? static_cast<double>(mismatched)/drawn : 0;
+    color = both > 0 ? sum/both : 0;
+  }
+
+  // particles not drawn or drawn twice by the cut
+  int coverageErrors(OctreeRenderer& renderer) {
+    const Octree& tree = renderer.tree();
+    const OctreeCut& cut = renderer.lodCut();
+    std::vector<int> covered(tree.points.size()/3, 0);
+    for (int pass = 0; pass < 2; pass++) {
+      const std::vector<int>& nodes = pass == 0 ? cut.nodes()
+                                                : cut.expandedLeaves();
+      for (unsigned i = 0; i < nodes.size(); i++) {
+        const Octree::Node& node = tree.nodes[nodes[i]];
+        for (int k = node.begin; k < node.end; k++)
+          covered[k]++;
+      }
+    }
+    int errors = 0;
+    for (unsigned k = 0; k < covered.size(); k++)
+      if (covered[k] != 1) errors++;
+    return errors;
+  }
+
+  bool view(OctreeRenderer& renderer, const OctreeRenderer::Camera& camera,
+            const char* name, const double coverageLimit,
+            const double colorLimit) {
+    std::vector<unsigned char> lod, full;
+    double tLod, tFull;
+    const int frames = paint(renderer, camera, lod, tLod);
+    const int points = renderer.lodCut().pointCount();
+    const int errors = coverageErrors(renderer);
+
+    // a repaint of the same view must not change the cut
+    double tRepaint;
+    std::vector<unsigned char> repaint;
+    paint(renderer, camera, repaint, tRepaint);
+
+    paintAll(renderer.tree(), full, tFull);
+    double coverage, color;
+    int differing;
+    compare(lod, full, coverage, color, differing);
+
+    std::printf("%s: %d of %d points in %d frames, %.4f s; all points"
+                " %.4f s\n", name, points, n, frames, tLod, tFull);
+    bool ok = check::expect("particles not drawn once", errors, 0);
+    ok = check::expect("repaint differing", repaint != lod, 0) && ok;
+    ok = check::expect("coverage difference, relative", coverage,
+                       coverageLimit) && ok;
+    ok = check::expect("mean color difference", color, colorLimit) && ok;
+    return check::expect("fraction of the points drawn",
+                         static_cast<double>(points)/n, 0.5) && ok;
+  }
+
+}
+
+int main() {
+  if (!makeContext()) {
+    std::printf("no EGL display with OpenGL, skipped\n");
+    return 77;
+  }
+  std::printf("%s, OpenGL %s\n", glGetString(GL_RENDERER),
+              glGetString(GL_VERSION));
+
+  OctreeRenderer renderer;
+  renderer.initialize();
+  renderer.resize(side, side);
+  double t = check::seconds();
+  renderer.setParticles(snapshot());
+  std::printf("octree of %d particles: %.3f s\n", n, check::seconds() - t);
+
+  OctreeRenderer::Camera camera;
+  camera.xRot = 20;
+  camera.yRot = 30;
+  bool ok = view(renderer, camera, "whole snapshot", 0.1, 0.05);
+
+  camera.zoom = 8;
+  camera.xPan = 0.05;
+  ok = view(renderer, camera, "zoomed in 8x", 0.1, 0.05) && ok;
+
+  // a cut without tolerance expands every leaf, and the merged ranges
+  // are one draw call over all points in the same order
+  camera.zoom = 1;
+  camera.xPan = 0;
+  renderer.lodCut().setTolerance(0);
+  renderer.lodCut().setPointBudget(n);
+  std::vector<unsigned char> lod, full;
+  double tLod, tFull;
+  const int frames = paint(renderer, camera, lod, tLod);
+  paintAll(renderer.tree(), full, tFull);
+  double coverage, color;
+  int differing;
+  compare(lod, full, coverage, color, differing);
+  std::printf("cut refined to all leaves: %d points in %d frames\n",
+              renderer.lodCut().pointCount(), frames);
+  ok = check::expect("pixels differing from all points", differing, 0)
+       && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Screened Coloumb forces from the Verlet list against all pairs, in an
+// open and in a periodic box: after the build, after moving the particles
+// by less than skin/2 (the list is reused) and by more (it is rebuilt).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double debye = 1, cutoff = 3, skin = 0.5, dt = 1e-3;
+
+  std::vector<Particle> particles(int n, double length) {
+    check::Random random(n);
+    std::vector<Particle> p(n);
+    for (int i = 0; i < n; i++) {
+      for (int d = 0; d < 3; d++)
+        p[i].position[d] = random.uniform(0, length);
+      p[i].mass = 1;
+      p[i].charge = (i % 2 ? 1 : -1)*1e-5;
+    }
+    return p;
+  }
+
+  // Particle::screenedColoumbForce for every pair within the cutoff
+  void allPairs(std::vector<Particle>& p, const PeriodicBox& box) {
+    const int n = p.size();
+    for (int i = 0; i < n; i++)
+      for (int j = i+1; j < n; j++) {
+        ThreeVector r = p[j].position - p[i].position;
+        box.minimumImage(r);
+        if (r.length() >= cutoff) continue;
+
+        // the pair method uses the plain separation
+        Particle a = p[i];
+        a.position = p[j].position - r;
+        a.screenedColoumbForce(p[j], dt, debye);
+        p[j].screenedColoumbForce(a, dt, debye);
+        p[i].dv = a.dv;
+      }
+  }
+
+  // moves every particle by distance in a random direction and clears
+  // the impulses
+  void move(std::vector<Particle>& p, double distance,
+            check::Random& random) {
+    for (unsigned int i = 0; i < p.size(); i++) {
+      double step[3], length;
+      do {
+        for (int d = 0; d < 3; d++)
+          step[d] = random.uniform(-1, 1);
+        length = std::sqrt(step[0]*step[0] + step[1]*step[1]
+                           + step[2]*step[2]);
+      } while (length > 1 || length < 0.1);
+      for (int d = 0; d < 3; d++)
+        p[i].position[d] += distance*step[d]/length;
+      p[i].dv.set(0, 0, 0);
+    }
+  }
+
+  double relativeError(const std::vector<Particle>& fast,
+                       const std::vector<Particle>& naive) {
+    double error = 0, scale = 0;
+    for (unsigned int i = 0; i < naive.size(); i++) {
+      error = std::max(error, (fast[i].dv - naive[i].dv).length());
+      scale = std::max(scale, naive[i].dv.length());
+    }
+    return error/scale;
+  }
+
+  bool compare(int n, double length, const PeriodicBox& box,
+               const char* name) {
+    std::vector<Particle> naive = particles(n, length);
+    std::vector<Particle> fast = naive;
+    check::Random random(n + 1);
+
+    double t = check::seconds();
+    allPairs(naive, box);
+    const double tNaive = check::seconds() - t;
+
+    ScreenedColoumbForce force(debye, cutoff, skin, box);
+    const VerletList& verlet = force.neighbourList();
+    t = check::seconds();
+    force.apply(fast, dt);
+    const double tBuild = check::seconds() - t;
+    const double errorBuild = relativeError(fast, naive);
+
+    // below skin/2 the list of the last step is reused
+    move(naive, 0.4*skin, random);
+    fast = naive;
+    allPairs(naive, box);
+    t = check::seconds();
+    force.apply(fast, dt);
+    const double tReuse = check::seconds() - t;
+    const double errorReuse = relativeError(fast, naive);
+    const int buildsReuse = verlet.buildCount();
+
+    // beyond skin/2 (from the positions of the build) it is rebuilt
+    move(naive, skin, random);
+    fast = naive;
+    allPairs(naive, box);
+    force.apply(fast, dt);
+    const double errorRebuild = relativeError(fast, naive);
+
+    std::printf("%s, %d particles: all pairs %.4f s, Verlet list %.4f s"
+                " (with build), %.4f s (reused), %d pairs\n", name, n,
+                tNaive, tBuild, tReuse, verlet.pairCount());
+    bool ok = check::expect("max |dv - dv_all-pairs| / max |dv|, built",
+                            errorBuild, 1e-12);
+    ok = check::expect("same, moved by less than skin/2", errorReuse,
+                       1e-12) && ok;
+    ok = check::expect("rebuilds after moving less than skin/2",
+                       buildsReuse - 1, 0) && ok;
+    ok = check::expect("same, moved by more than skin/2", errorRebuild,
+                       1e-12) && ok;
+    return check::expect("missing rebuild after moving beyond skin/2",
+                         verlet.buildCount() != 2, 0) && ok;
+  }
+
+}
+
+int main() {
+  bool ok = true;
+  ok = compare(4000, 20, PeriodicBox(), "open box") && ok;
+  ok = compare(4000, 20, PeriodicBox(20, 20, 20), "periodic box") && ok;
+  ok = compare(8000, 25, PeriodicBox(25, 25, 25), "periodic box") && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Particle-mesh gravity and Coloumb forces, with cloud-in-cell and
+// triangular shaped cloud assignment, against the direct pair sums:
+// far apart particles, where the mesh should be accurate, and a uniform
+// sphere of many particles, where the mesh smooths out the contributions
+// of close neighbours. Errors are relative to the RMS of the exact dv.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_particle-mesh.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double dt = 1;
+
+  // direct sums through ParticleArray, which does the same as the Particle
+  // pair methods
+  void direct(std::vector<Particle>& p, const bool charges) {
+    ParticleArray a(p);
+    a.clearDv();
+    if (charges)
+      a.coloumbForces(dt);
+    else
+      a.gravitationalForces(dt);
+    a.store(p);
+  }
+
+  // maximum and RMS of |dv - dv_direct|, relative to the RMS of dv_direct
+  void errors(const std::vector<Particle>& mesh,
+              const std::vector<Particle>& exact, double& max,
+              double& rms) {
+    double scale = 0;
+    max = rms = 0;
+    for (unsigned i = 0; i < mesh.size(); i++) {
+      const double e = (mesh[i].dv - exact[i].dv).length();
+      max = std::max(max, e);
+      rms += e*e;
+      scale += exact[i].dv*exact[i].dv;
+    }
+    scale = std::sqrt(scale/mesh.size());
+    max /= scale;
+    rms = std::sqrt(rms/mesh.size())/scale;
+  }
+
+  // both assignment schemes against one direct sum
+  bool compare(const std::vector<Particle>& particles, const bool charges,
+               const int grid, const char* name, const double maxLimit,
+               const double rmsLimit) {
+    std::vector<Particle> exact = particles;
+    for (unsigned i = 0; i < particles.size(); i++)
+      exact[i].dv = ThreeVector(0, 0, 0);
+
+    double t = check::seconds();
+    direct(exact, charges);
+    const double tDirect = check::seconds() - t;
+
+    bool ok = true;
+    const ParticleMesh::Assignment schemes[] = {ParticleMesh::CIC,
+                                                ParticleMesh::TSC};
+    for (int s = 0; s < 2; s++) {
+      std::vector<Particle> mesh = particles;
+      for (unsigned i = 0; i < particles.size(); i++)
+        mesh[i].dv = ThreeVector(0, 0, 0);
+
+      ParticleMesh pm(grid, schemes[s]);
+      t = check::seconds();
+      if (charges)
+        pm.coloumbForce(mesh, dt);
+      else
+        pm.gravitationalForce(mesh, dt);
+      const double tMesh = check::seconds() - t;
+
+      double max, rms;
+      errors(mesh, exact, max, rms);
+      std::printf("%s (%s, %s), %d particles, %d^3 grid: direct %.4f s,"
+                  " mesh %.4f s\n", name, charges ? "Coloumb" : "gravity",
+                  schemes[s] == ParticleMesh::CIC ? "CIC" : "TSC",
+                  static_cast<int>(particles.size()), grid, tDirect, tMesh);
+      ok = check::expect("max relative error", max, maxLimit) && ok;
+      ok = check::expect("RMS relative error", rms, rmsLimit) && ok;
+    }
+    return ok;
+  }
+
+  // a few equal bodies spread over a cube, separations >> grid spacing
+  std::vector<Particle> sparse() {
+    check::Random random(3);
+    std::vector<Particle> p(8);
+    for (unsigned i = 0; i < p.size(); i++) {
+      for (int d = 0; d < 3; d++)
+        p[i].position[d] = (d == 0 ? i % 2 : d == 1 ? i/2 % 2 : i/4)
+                           + random.uniform(-0.1, 0.1);
+      p[i].mass = 1e10;
+      p[i].charge = i % 3 ? 1e-6 : -1e-6;
+    }
+    return p;
+  }
+
+  // Sphere of radius 1 filled with a jittered lattice of the given
+  // spacing, so that no two particles are closer than spacing/2. Closer
+  // pairs are not resolved by the mesh.
+  std::vector<Particle> sphere(const double spacing) {
+    check::Random random(7);
+    std::vector<Particle> p;
+    const int m = static_cast<int>(1/spacing);
+    for (int i = -m; i <= m; i++)
+      for (int j = -m; j <= m; j++)
+        for (int k = -m; k <= m; k++) {
+          Particle q;
+          q.position.set(i, j, k);
+          q.position *= spacing;
+          if (q.position.length() > 1) continue;
+          for (int d = 0; d < 3; d++)
+            q.position[d] += random.uniform(-0.25, 0.25)*spacing;
+          q.mass = 1e10;
+          q.charge = 1e-6;
+          p.push_back(q);
+        }
+    return p;
+  }
+
+}
+
+int main() {
+  bool ok = true;
+  const std::vector<Particle> bodies = sparse();
+  ok = compare(bodies, false, 64, "separated bodies", 1e-2, 5e-3) && ok;
+  ok = compare(bodies, true, 64, "separated bodies", 1e-2, 5e-3) && ok;
+
+  const std::vector<Particle> uniform = sphere(0.05);
+  ok = compare(uniform, false, 64, "uniform sphere", 0.15, 0.04) && ok;
+  ok = compare(uniform, true, 64, "uniform sphere", 0.15, 0.04) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// LorentzBoost against the invariants it has to keep and against
+// SpecialRelativity::addVelocities, which it replaces for whole arrays:
+// events keep their interval, four-momenta stay on the mass shell and the
+// velocities equal the per-particle composition with -V.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_4-vector.h"
+#include "bps_constants.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_particle-array-boost.h"
+#include "bps_relativity.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const double c = BPS_CONST_SPEED_OF_LIGHT;
+
+  // random velocity with a speed below fraction*c
+  ThreeVector velocity(check::Random& random, const double fraction) {
+    ThreeVector v;
+    do {
+      for (int d = 0; d < 3; d++)
+        v[d] = random.uniform(-1, 1);
+    } while (v.length() > 1);
+    return fraction*c*v;
+  }
+
+  double gamma(const ThreeVector& v) {
+    return 1/std::sqrt(1 - v*v/(c*c));
+  }
+
+  bool invariants(const std::vector<Particle>& particles,
+                  const std::vector<double>& time, const LorentzBoost& boost) {
+    const int n = particles.size();
+
+    // events (ct, x, y, z) and four-momenta (E/c, p) through the bulk
+    // method for raw arrays
+    std::vector<double> e0(n), e1(n), e2(n), e3(n);
+    std::vector<double> p0(n), p1(n), p2(n), p3(n);
+    for (int i = 0; i < n; i++) {
+      const Particle& q = particles[i];
+      e0[i] = c*time[i];
+      e1[i] = q.position[0];
+      e2[i] = q.position[1];
+      e3[i] = q.position[2];
+      const double m = gamma(q.velocity)*q.mass;
+      p0[i] = m*c;
+      p1[i] = m*q.velocity[0];
+      p2[i] = m*q.velocity[1];
+      p3[i] = m*q.velocity[2];
+    }
+    boost.apply(n, &e0[0], &e1[0], &e2[0], &e3[0]);
+    boost.apply(n, &p0[0], &p1[0], &p2[0], &p3[0]);
+
+    // the same through ParticleArrayBoost, for the velocities
+    ParticleArray a(particles);
+    std::vector<double> t = time;
+    ParticleArrayBoost(boost).apply(a, t);
+
+    double interval = 0, shell = 0, events = 0, velocities = 0;
+    for (int i = 0; i < n; i++) {
+      const Particle& q = particles[i];
+      const FourVector before(c*time[i], q.position);
+      const FourVector after(e0[i], e1[i], e2[i], e3[i]);
+      const double scale = before[0]*before[0] + q.position*q.position;
+      interval = std::max(interval, std::fabs(after.interval()
+                                              - before.interval())/scale);
+
+      const double m_c = q.mass*c;
+      const FourVector p(p0[i], p1[i], p2[i], p3[i]);
+      shell = std::max(shell, std::fabs(p.interval() - m_c*m_c)/(m_c*m_c));
+
+      events = std::max(events, (std::fabs(c*t[i] - e0[i])
+                                 + std::fabs(a.x[i] - e1[i])
+                                 + std::fabs(a.y[i] - e2[i])
+                                 + std::fabs(a.z[i] - e3[i]))
+                                /std::sqrt(scale));
+
+      const ThreeVector v(a.vx[i], a.vy[i], a.vz[i]);
+      const ThreeVector u(c*p1[i]/p0[i], c*p2[i]/p0[i], c*p3[i]/p0[i]);
+      velocities = std::max(velocities, (v - u).length()/c);
+    }
+
+    bool ok = check::expect("interval, relative", interval, 1e-12);
+    ok = check::expect("mass shell, relative", shell, 1e-12) && ok;
+    ok = check::expect("events, array against raw", events, 1e-13) && ok;
+    return check::expect("velocities against momenta / c", velocities,
+                         1e-14) && ok;
+  }
+
+  bool composition(const std::vector<Particle>& particles,
+                   const LorentzBoost& boost) {
+    const int n = particles.size();
+    const ThreeVector V = boost.getVelocity();
+
+    std::vector<Particle> composed = particles;
+    double t = check::seconds();
+    for (int i = 0; i < n; i++)
+      composed[i].velocity =
+        SpecialRelativity::addVelocities(composed[i].velocity, -V);
+    const double tComposed = check::seconds() - t;
+
+    ParticleArray a(particles);
+    const ParticleArrayBoost bulk(boost);
+    t = check::seconds();
+    bulk.applyToVelocities(a);
+    const double tBulk = check::seconds() - t;
+
+    double error = 0;
+    for (int i = 0; i < n; i++) {
+      const ThreeVector v(a.vx[i], a.vy[i], a.vz[i]);
+      error = std::max(error, (v - composed[i].velocity).length()/c);
+    }
+
+    std::printf("%d velocities: addVelocities %.4f s, bulk boost %.4f s\n",
+                n, tComposed, tBulk);
+    // the time ratio is only printed, it depends on the load of the machine
+    std::printf("  bulk time / addVelocities time %.3f\n", tBulk/tComposed);
+    return check::expect("max |v - addVelocities| / c", error, 1e-14);
+  }
+
+}
+
+int main() {
+  check::Random random(11);
+  const int n = 200000;
+  std::vector<Particle> particles(n);
+  std::vector<double> time(n);
+  for (int i = 0; i < n; i++) {
+    for (int d = 0; d < 3; d++)
+      particles[i].position[d] = random.uniform(-1e3, 1e3);
+    particles[i].velocity = velocity(random, 0.45);
+    particles[i].mass = random.uniform(1, 2)*BPS_CONST_MASS_ELECTRON;
+    time[i] = random.uniform(-1e-6, 1e-6);
+  }
+
+  bool ok = true;
+  const double speeds[] = {0.01, 0.45, 0.99};
+  for (int k = 0; k < 3; k++) {
+    const ThreeVector direction = velocity(random, 1).normalized();
+    const LorentzBoost boost(speeds[k]*c*direction);
+    std::printf("boost to %.2f c, %d particles\n",
+                boost.getVelocity().length()/c, n);
+    ok = invariants(particles, time, boost) && ok;
+    ok = composition(particles, boost) && ok;
+  }
+
+  // a zero direction has no boost to give
+  const LorentzBoost identity =
+    LorentzBoost::fromRapidity(ThreeVector(), 1);
+  const FourVector event(1, 2, 3, 4);
+  std::printf("fromRapidity with a zero direction\n");
+  ok = check::expect("distance from the identity",
+                     (identity.apply(event) - event).length(), 0) && ok;
+
+  // speeds of c and above have no boost either
+  const double tooFast[] = {1, 1 + 1e-9, 2, NAN};
+  int accepted = 0;
+  for (int k = 0; k < 4; k++) {
+    try {
+      LorentzBoost(ThreeVector(0, tooFast[k]*c, 0));
+      accepted++;
+    } catch (std::invalid_argument&) {
+    }
+  }
+  try {
+    LorentzBoost::fromRapidity(ThreeVector(1, 0, 0), 40);
+    accepted++;
+  } catch (std::invalid_argument&) {
+  }
+  std::printf("boosts to c, beyond c, NaN and rapidity 40\n");
+  ok = check::expect("accepted", accepted, 0) && ok;
+  return ok ? 0 : 1;
+}
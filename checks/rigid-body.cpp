@@ -0,0 +1,214 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// RigidBodies against the invariants of free and interacting rotation:
+// asymmetric tops have to keep their energy, their angular momentum in
+// the world frame and unit quaternions without renormalization, the axis
+// of a symmetric top has to precess about the angular momentum at |L|/I1,
+// and charged dumbbells pushing each other through their sites have to
+// keep the total momentum and angular momentum.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_quaternion.h"
+#include "bps_rigid-body.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  // a point of mass 1 with the given principal moments
+  int addTop(RigidBodies& bodies, const double i1, const double i2,
+             const double i3, const Quaternion& q, const ThreeVector& w) {
+    const double inertia[9] = {i1, 0, 0, 0, i2, 0, 0, 0, i3};
+    std::vector<Particle> site(1);
+    site[0].mass = 1;
+    return bodies.addBody(site, ThreeVector(0, 0, 0), q, ThreeVector(0, 0, 0),
+                          w, inertia);
+  }
+
+  // q v q*
+  ThreeVector rotate(const Quaternion& q, const ThreeVector& v) {
+    const Quaternion r = q*Quaternion(0, v)*q.conjugated();
+    return ThreeVector(r.getIm1(), r.getIm2(), r.getIm3());
+  }
+
+  bool asymmetricTops() {
+    const int n = 1000;
+    const int steps = 10000;
+    const double dt = 1e-3;
+
+    check::Random random(19);
+    RigidBodies bodies;
+    bodies.setRenormalizeInterval(0);
+    for (int b = 0; b < n; b++) {
+      Quaternion q(random.uniform(-1, 1), random.uniform(-1, 1),
+                   random.uniform(-1, 1), random.uniform(-1, 1));
+      q /= q.length();
+      const ThreeVector w(random.uniform(-1, 1), random.uniform(-1, 1),
+                          random.uniform(-1, 1));
+      addTop(bodies, 1, 2, 3, q, w);
+    }
+
+    const double energy = bodies.kineticEnergy();
+    std::vector<ThreeVector> momentum(n);
+    for (int b = 0; b < n; b++)
+      momentum[b] = bodies.angularMomentum(b);
+
+    double energyError = 0;
+    const double t = check::seconds();
+    for (int s = 0; s < steps; s++) {
+      bodies.update(dt);
+      if (s % 100 == 99)
+        energyError = std::max(energyError, std::fabs(bodies.kineticEnergy()
+                                                      /energy - 1));
+    }
+    const double seconds = check::seconds() - t;
+
+    double momentumError = 0, normError = 0;
+    for (int b = 0; b < n; b++) {
+      momentumError = std::max(momentumError,
+                               (bodies.angularMomentum(b) - momentum[b])
+                               .length()/momentum[b].length());
+      normError = std::max(normError,
+                           std::fabs(bodies.orientation(b).length() - 1));
+    }
+
+    std::printf("%d asymmetric tops (1, 2, 3), %d steps of |w| dt < 2e-3"
+                " without renormalization: %.3g body updates/s\n", n, steps,
+                1.0*n*steps/seconds);
+    // the energy error of the splitting is bounded, O(dt^2); the rest
+    // is rounding, about 1e-16 per step
+    bool ok = check::expect("kinetic energy, relative", energyError, 1e-8);
+    ok = check::expect("angular momentum, relative", momentumError, 1e-11)
+         && ok;
+    ok = check::expect("|q| - 1", normError, 1e-11) && ok;
+
+    bodies.renormalize();
+    normError = 0;
+    for (int b = 0; b < n; b++)
+      normError = std::max(normError,
+                           std::fabs(bodies.orientation(b).length() - 1));
+    return check::expect("|q| - 1 after renormalize", normError, 1e-15)
+           && ok;
+  }
+
+  bool symmetricTop() {
+    const double i1 = 1, i3 = 2;
+    const int steps = 10000;
+    const double dt = 1e-3;
+
+    RigidBodies bodies;
+    const ThreeVector w(1, 0, 2);
+    addTop(bodies, i1, i1, i3, Quaternion(1, 0, 0, 0), w);
+    const ThreeVector l = bodies.angularMomentum(0);
+    const double body3 = bodies.lz[0];
+
+    double axisError = 0, spinError = 0;
+    for (int s = 1; s <= steps; s++) {
+      bodies.update(dt);
+      if (s % 100) continue;
+
+      // the figure axis precesses about L at |L|/I1
+      ThreeVector expected(0, 0, 1);
+      expected.rotate(l, l.length()/i1*s*dt);
+      const ThreeVector axis = rotate(bodies.orientation(0),
+                                      ThreeVector(0, 0, 1));
+      axisError = std::max(axisError, (axis - expected).length());
+      spinError = std::max(spinError, std::fabs(bodies.lz[0] - body3));
+    }
+
+    std::printf("symmetric top (1, 1, 2), w = (1, 0, 2), %d steps of %g\n",
+                steps, dt);
+    // the rotations about the first two axes change L3 by O(dt^2)
+    bool ok = check::expect("figure axis", axisError, 1e-5);
+    return check::expect("body L3", spinError, 1e-7) && ok;
+  }
+
+  // total momentum and angular momentum about the origin
+  void totals(const RigidBodies& bodies, ThreeVector& p, ThreeVector& l) {
+    p = l = ThreeVector(0, 0, 0);
+    for (int b = 0; b < bodies.size(); b++) {
+      const ThreeVector v = bodies.mass[b]*ThreeVector(bodies.vx[b],
+                                                       bodies.vy[b],
+                                                       bodies.vz[b]);
+      p += v;
+      l += cross(ThreeVector(bodies.x[b], bodies.y[b], bodies.z[b]), v)
+           + bodies.angularMomentum(b);
+    }
+  }
+
+  bool dumbbells() {
+    const int steps = 2000;
+    const double dt = 1e-3;
+    const double q = 1e-5;
+
+    // two sites of 1 kg, 1 m apart, with like charges
+    std::vector<Particle> sites(2);
+    for (int i = 0; i < 2; i++) {
+      sites[i].mass = 1;
+      sites[i].charge = q;
+      sites[i].position = ThreeVector(i - 0.5, 0, 0);
+    }
+    RigidBodies bodies;
+    bodies.addBody(sites, ThreeVector(-1, 0.2, 0), Quaternion(1, 0, 0, 0),
+                   ThreeVector(1, 0, 0.1), ThreeVector(0, 0.5, 3));
+    sites[1].charge = 2*q;
+    Quaternion turn(1, 0.3, 0.2, 0.1);
+    turn /= turn.length();
+    bodies.addBody(sites, ThreeVector(1.5, -0.3, 0.4), turn,
+                   ThreeVector(-0.5, 0.2, 0), ThreeVector(-2, 0, 1));
+
+    ThreeVector p0, l0, p, l;
+    totals(bodies, p0, l0);
+    const double energy = bodies.kineticEnergy();
+    ParticleArray s;
+    for (int t = 0; t < steps; t++) {
+      bodies.sites(s);
+      s.coloumbForces(dt);
+      bodies.applyImpulses(s).update(dt);
+    }
+    totals(bodies, p, l);
+
+    // the bodies have to have interacted
+    const double change = std::fabs(bodies.kineticEnergy()/energy - 1);
+
+    std::printf("two charged dumbbells, %d steps of %g s\n", steps, dt);
+    bool ok = check::expect("momentum, relative", (p - p0).length()
+                            /p0.length(), 1e-13);
+    ok = check::expect("angular momentum, relative", (l - l0).length()
+                       /l0.length(), 1e-12) && ok;
+    return check::expect("kinetic energy unchanged", change < 1e-3, 0) && ok;
+  }
+
+} // namespace
+
+int main() {
+  bool ok = asymmetricTops();
+  ok = symmetricTop() && ok;
+  ok = dumbbells() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// The sweeps of bps_run: the parser against a specification with known
+// runs and against invalid ones, and the simulations against their
+// statuses. Runs have to be reproducible on a reused workspace, invalid
+// parameters and runs that blow up must not be reported as "ok".
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "simulation.h"
+#include "sweep.h"
+
+namespace {
+
+  bool read(Sweep& sweep, const std::string& text) {
+    std::istringstream in(text);
+    std::string error;
+    return sweep.read(in, error);
+  }
+
+  bool parse() {
+    Sweep sweep;
+    const bool ok = read(sweep,
+                         "# runs of a small gravity model\n"
+                         "model = gravity\n"
+                         "particles = 8 16   # two sizes\n"
+                         "temperature = 1e3 1e4 1e5\n"
+                         "\n"
+                         "seeds = 1:3 7\n"
+                         "threads = 2\n"
+                         "pin = no\n"
+                         "output = gravity.tsv\n");
+
+    // the seed varies fastest, then the last parameter
+    const Sweep::Run r = sweep.run(17);
+    int errors = !ok;
+    errors += sweep.getModel() != "gravity";
+    errors += sweep.getOutput() != "gravity.tsv";
+    errors += sweep.getThreads() != 2;
+    errors += sweep.getPin();
+    errors += sweep.names().size() != 2;
+    errors += sweep.runCount() != 24;
+    errors += r.index != 17 || r.seed != 2 || r.values.size() != 2;
+    errors += r.values.size() == 2 && (r.values[0] != 16 ||
+                                       r.values[1] != 1e4);
+
+    std::printf("sweep of 2 x 3 parameter sets and 4 seeds\n");
+    return check::expect("wrong settings or runs", errors, 0);
+  }
+
+  bool reject() {
+    const char* const invalid[] = {
+      "particles\n", "particles =\n", "model = liquid\n", "size = 3\n",
+      "threads = 1 2\n", "threads = -1\n", "threads = 5000\n",
+      "pin = true\n", "pin = 1\n", "seeds = 5:3\n", "seeds = a\n",
+      "seeds = 0:1000000\n", "particles = 1.5\n", "steps = -1\n",
+      "particles = 3e9\n", "dt = 0\n", "dt = inf\n", "density = -1e20\n",
+      "density = 0\n", "temperature = 0\n", "temperature = nan\n",
+      "mass = 0\n", "mass = -1\n", "debye = 0\n", "debye = -1e-7\n",
+      "cutoff = -1\n", "cutoff = inf\n", "charge = nan\n",
+      "charge = 1e400\n",
+      // 10^10 runs, more than the run indices take
+      "particles = 10 20 30 40 50 60 70 80 90 100\n"
+      "steps = 10 20 30 40 50 60 70 80 90 100\n"
+      "temperature = 1e1 1e2 1e3 1e4 1e5 1e6 1e7 1e8 1e9 1e10\n"
+      "dt = 1e-18 1e-17 1e-16 1e-15 1e-14 1e-13 1e-12 1e-11 1e-10 1e-9\n"
+      "seeds = 1:1000000\n"
+    };
+    const int count = sizeof(invalid)/sizeof(invalid[0]);
+    int accepted = 0;
+    for (int k = 0; k < count; k++) {
+      Sweep sweep;
+      if (read(sweep, invalid[k])) {
+        std::printf("  accepted: %s", invalid[k]);
+        accepted++;
+      }
+    }
+
+    const char* const valid[] = {
+      "pin = yes\n", "pin = no\n", "charge = -1.6e-19 0\n", "cutoff = 0\n",
+      "particles = 0\n"
+    };
+    int rejected = 0;
+    for (int k = 0; k < 5; k++) {
+      Sweep sweep;
+      if (!read(sweep, valid[k])) {
+        std::printf("  rejected: %s", valid[k]);
+        rejected++;
+      }
+    }
+
+    std::printf("%d invalid and 5 valid specifications\n", count);
+    bool ok = check::expect("invalid ones accepted", accepted, 0);
+    return check::expect("valid ones rejected", rejected, 0) && ok;
+  }
+
+  Sweep::Run run(const double value, const unsigned long seed = 1) {
+    Sweep::Run r;
+    r.index = 0;
+    r.seed = seed;
+    r.values.push_back(value);
+    return r;
+  }
+
+  bool simulate() {
+    std::vector<std::string> names;
+    names.push_back("particles");
+    Simulation plasma("plasma", names), gravity("gravity", names);
+
+    // the second run on each workspace reuses its buffers
+    int errors = 0;
+    const char* const models[] = {"plasma", "gravity"};
+    Simulation* simulations[] = {&plasma, &gravity};
+    for (int m = 0; m < 2; m++) {
+      const Simulation::Summary a = simulations[m]->run(run(200, 3));
+      simulations[m]->run(run(300, 4));
+      const Simulation::Summary b = simulations[m]->run(run(200, 3));
+      if (a.status != "ok" || !(a.kineticEnergy > 0) ||
+          !(a.rmsSpeed > 0) || a.kineticEnergy != b.kineticEnergy ||
+          a.initialKineticEnergy != b.initialKineticEnergy) {
+        std::printf("  %s: %s, %g J, again %g J\n", models[m],
+                    a.status.c_str(), a.kineticEnergy, b.kineticEnergy);
+        errors++;
+      }
+    }
+
+    // 3 particles give a box below twice the cutoff
+    const Simulation::Summary small = plasma.run(run(3));
+    errors += small.status != "cutoff exceeds half the box";
+
+    // runs that do not come from Sweep::read are checked as well
+    names[0] = "density";
+    Simulation invalid("plasma", names);
+    const double values[] = {0, -1e20, NAN, INFINITY};
+    for (int k = 0; k < 4; k++) {
+      const Simulation::Summary s = invalid.run(run(values[k]));
+      if (s.status == "ok" || s.kineticEnergy != 0) {
+        std::printf("  density %g: %s\n", values[k], s.status.c_str());
+        errors++;
+      }
+    }
+
+    // the particles fly apart at a non-finite speed
+    names[0] = "mass";
+    Simulation heavy("gravity", names);
+    const Simulation::Summary s = heavy.run(run(1e300));
+    errors += s.status != "diverged";
+
+    std::printf("plasma and gravity runs, skipped and diverged runs\n");
+    return check::expect("wrong summaries", errors, 0);
+  }
+
+} // namespace
+
+int main() {
+  bool ok = parse();
+  ok = reject() && ok;
+  ok = simulate() && ok;
+  return ok ? 0 : 1;
+}
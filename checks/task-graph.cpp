@@ -0,0 +1,244 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// StepPipeline against the serial loop it replaces: on several threads
+// and across two runs it has to give the same particles bit for bit, and
+// the diagnostics have to see the state after each step. TaskGraph has to
+// run every instance after its prerequisites, reject cycles of lag 0 and
+// dependencies on tasks it does not have.
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_particle-array.h"
+#include "bps_step-pipeline.h"
+#include "bps_task-graph.h"
+#include "check.h"
+
+using namespace bps;
+
+namespace {
+
+  const int n = 500;
+  const int steps = 10;
+  const double dt = 1e-11;
+
+  ParticleArray protons() {
+    check::Random random(7);
+    ParticleArray a(n);
+    for (int i = 0; i < n; i++) {
+      a.x[i] = random.uniform(0, 1e-5);
+      a.y[i] = random.uniform(0, 1e-5);
+      a.z[i] = random.uniform(0, 1e-5);
+      a.vx[i] = random.uniform(-1e4, 1e4);
+      a.vy[i] = random.uniform(-1e4, 1e4);
+      a.vz[i] = random.uniform(-1e4, 1e4);
+      a.mass[i] = BPS_CONST_MASS_PROTON;
+      a.charge[i] = BPS_CONST_ELEMENTARY_CHARGE;
+    }
+    return a;
+  }
+
+  double sum(const std::vector<double>& v) {
+    double s = 0;
+    for (unsigned int i = 0; i < v.size(); i++)
+      s += v[i];
+    return s;
+  }
+
+  // sum of the positions after each step, indexed by step
+  void observe(const ParticleArray& snapshot, const int step, void* data) {
+    std::vector<double>& sums = *static_cast<std::vector<double>*>(data);
+    sums[step] = sum(snapshot.x) + sum(snapshot.y) + sum(snapshot.z);
+  }
+
+  void count(ParticleArray&, const int step, void* data) {
+    std::vector<int>& calls = *static_cast<std::vector<int>*>(data);
+    calls[step]++;
+  }
+
+  int differences(const std::vector<double>& a, const std::vector<double>& b) {
+    int count = 0;
+    for (unsigned int i = 0; i < a.size(); i++)
+      count += a[i] != b[i];
+    return count;
+  }
+
+  bool pipeline() {
+    ParticleArray serial = protons();
+    std::vector<double> serialSums(2*steps + 1, 0);
+    double t = check::seconds();
+    for (int s = 0; s < 2*steps; s++) {
+      serial.clearDv();
+      serial.gravitationalForces(dt);
+      serial.coloumbForces(dt);
+      serial.updatePositions(dt);
+      serialSums[s + 1] = sum(serial.x) + sum(serial.y) + sum(serial.z);
+    }
+    const double tSerial = check::seconds() - t;
+
+    ParticleArray a = protons();
+    std::vector<double> sums(2*steps + 1, 0);
+    std::vector<int> calls(2*steps, 0);
+    StepPipeline p(a, dt, StepPipeline::Gravitational | StepPipeline::Coloumb,
+                   7);
+    p.setPrepare(count, &calls).setDiagnostics(observe, &sums);
+    t = check::seconds();
+    p.run(steps, 4).run(steps, 4);
+    const double tPipeline = check::seconds() - t;
+
+    int calledWrong = 0;
+    for (int s = 0; s < 2*steps; s++)
+      calledWrong += calls[s] != 1;
+
+    std::printf("StepPipeline, %d particles in 7 tiles, 2 x %d steps on 4"
+                " threads: %.3f s, serial %.3f s\n", n, steps, tPipeline,
+                tSerial);
+    bool ok = check::expect("positions different",
+                            differences(a.x, serial.x)
+                            + differences(a.y, serial.y)
+                            + differences(a.z, serial.z), 0);
+    ok = check::expect("velocities different",
+                       differences(a.vx, serial.vx)
+                       + differences(a.vy, serial.vy)
+                       + differences(a.vz, serial.vz), 0) && ok;
+    ok = check::expect("diagnostics different",
+                       differences(sums, serialSums), 0) && ok;
+    ok = check::expect("steps not prepared once", calledWrong, 0) && ok;
+    return check::expect("step count wrong", p.getStep() != 2*steps, 0)
+           && ok;
+  }
+
+  // finishing position of each instance
+  struct Order {
+    int tasks;
+    std::vector<int> position;
+    int next;
+  };
+
+  struct Instance {
+    Order* order;
+    int task;
+  };
+
+  void record(void* data, const int iteration) {
+    const Instance* i = static_cast<Instance*>(data);
+    Order* o = i->order;
+    // the checks are built without OpenMP, the tasks run with it
+    const int position = __atomic_fetch_add(&o->next, 1, __ATOMIC_SEQ_CST);
+    o->position[iteration*o->tasks + i->task] = position;
+  }
+
+  bool order() {
+    // a chain with lag 0, a task with lag 1 and 2 back into it and one
+    // depending on two others
+    const int tasks = 5;
+    const int iterations = 50;
+    const int dependencies[][3] = {{1, 0, 0}, {2, 1, 0}, {0, 3, 1},
+                                   {3, 2, 0}, {0, 2, 2}, {4, 1, 0},
+                                   {4, 3, 0}};
+    Order o;
+    o.tasks = tasks;
+    o.position.assign(tasks*iterations, -1);
+    o.next = 0;
+    std::vector<Instance> instances(tasks);
+    TaskGraph graph;
+    for (int t = 0; t < tasks; t++) {
+      instances[t].order = &o;
+      instances[t].task = t;
+      graph.add("task", record, &instances[t]);
+    }
+    for (int d = 0; d < 7; d++)
+      graph.depend(dependencies[d][0], dependencies[d][1],
+                   dependencies[d][2]);
+    graph.run(iterations, 4);
+
+    int early = 0;
+    for (int k = 0; k < iterations; k++) {
+      for (int t = 0; t < tasks; t++) {
+        const int i = o.position[k*tasks + t];
+        if (i < 0) early++;
+        if (k > 0 && i < o.position[(k - 1)*tasks + t]) early++;
+        for (int d = 0; d < 7; d++) {
+          const int lag = dependencies[d][2];
+          if (dependencies[d][0] != t || k < lag) continue;
+          if (i < o.position[(k - lag)*tasks + dependencies[d][1]]) early++;
+        }
+      }
+    }
+
+    std::printf("TaskGraph, %d tasks with lags 0 to 2, %d iterations on 4"
+                " threads\n", tasks, iterations);
+    return check::expect("instances run early or not at all", early, 0);
+  }
+
+  void nothing(void*, const int) {}
+
+  bool reject() {
+    int accepted = 0;
+
+    // lag 0 from a to b, b to c, c to a
+    TaskGraph cycle;
+    for (int t = 0; t < 3; t++)
+      cycle.add("cycle", nothing);
+    cycle.depend(1, 0).depend(2, 1).depend(0, 2);
+    try {
+      cycle.run(2);
+      accepted++;
+    } catch (std::invalid_argument&) {
+    }
+
+    // the same with a lag on one edge is fine
+    TaskGraph lagged;
+    for (int t = 0; t < 3; t++)
+      lagged.add("lagged", nothing);
+    lagged.depend(1, 0).depend(2, 1).depend(0, 2, 1);
+    int rejected = 0;
+    try {
+      lagged.run(2);
+    } catch (std::invalid_argument&) {
+      rejected++;
+    }
+
+    const int invalid[][3] = {{-1, 0, 0}, {3, 0, 0}, {0, -1, 0},
+                              {0, 3, 0}, {0, 1, -1}};
+    for (int d = 0; d < 5; d++) {
+      try {
+        lagged.depend(invalid[d][0], invalid[d][1], invalid[d][2]);
+        accepted++;
+      } catch (std::invalid_argument&) {
+      }
+    }
+
+    std::printf("cycles and invalid dependencies\n");
+    bool ok = check::expect("invalid graphs accepted", accepted, 0);
+    return check::expect("lagged cycle rejected", rejected, 0) && ok;
+  }
+
+} // namespace
+
+int main() {
+  bool ok = pipeline();
+  ok = order() && ok;
+  ok = reject() && ok;
+  return ok ? 0 : 1;
+}
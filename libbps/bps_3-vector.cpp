@@ -17,6 +17,7 @@
 */
 
 #include <cmath>
+#include <ostream>
 
 #include "bps_3-vector.h"
 #include "bps_quaternion.h"
@@ -37,4 +38,10 @@ namespace bps {
     return *this;
   }
 
+  std::ostream& operator<<(std::ostream& os, const ThreeVector& v) {
+    return os << "ThreeVector(" << v.getX() << ", "
+                                << v.getY() << ", "
+                                << v.getZ() << ")";
+  }
+
 } // namespace bps
@@ -89,11 +89,7 @@ namespace bps {
     return std::acos((v*w)/(v.length()*w.length()));
   }
 
-  std::ostream& operator<<(std::ostream& os, const ThreeVector& v) {
-    return os << "ThreeVector(" << v.getX() << ", "
-                                << v.getY() << ", "
-                                << v.getZ() << ")";
-  }
+  std::ostream& operator<<(std::ostream&, const ThreeVector&);
 
 } // namesapce bps
 
@@ -0,0 +1,94 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_4_VECTOR_H
+#define BPS_4_VECTOR_H
+
+#include <cmath>
+#include <ostream>
+
+#include "bps_3-vector.h"
+#include "bps_n-vector.h"
+
+namespace bps {
+
+  // Minkowski four-vector (x0, x1, x2, x3) with metric (+, -, -, -), e.g.
+  // an event (ct, x, y, z) or a four-momentum (E/c, px, py, pz).
+  class FourVector : public Vector<double, 4> {
+    public:
+      inline FourVector(double _x0 = 0, double _x1 = 0, double _x2 = 0,
+                        double _x3 = 0) {
+        x[0] = _x0;
+        x[1] = _x1;
+        x[2] = _x2;
+        x[3] = _x3;
+      }
+
+      inline FourVector(double _x0, const Vector<double, 3>& s) {
+        x[0] = _x0;
+        x[1] = s[0];
+        x[2] = s[1];
+        x[3] = s[2];
+      }
+
+      template<class T, int n>
+      inline FourVector(const Vector<T, n>& v) {
+        int m = std::min(size(), n);
+        for (int i = 0; i < m; i++)
+          x[i] = v[i];
+      }
+
+      template<class T, int n>
+      inline FourVector& operator=(const Vector<T, n>& v) {
+        int m = std::min(size(), n);
+        for (int i = 0; i < m; i++)
+          x[i] = v[i];
+        return *this;
+      }
+
+      // getter
+      inline double getTime() const { return x[0]; }
+      inline ThreeVector getSpace() const {
+        return ThreeVector(x[1], x[2], x[3]);
+      }
+
+      // setter
+      inline FourVector& setTime(double _x0) { x[0] = _x0; return *this; }
+      inline FourVector& setSpace(const ThreeVector& s) {
+        x[1] = s[0];
+        x[2] = s[1];
+        x[3] = s[2];
+        return *this;
+      }
+
+      // invariant x0^2 - x1^2 - x2^2 - x3^2
+      inline double interval() const {
+        return x[0]*x[0] - x[1]*x[1] - x[2]*x[2] - x[3]*x[3];
+      }
+  };
+
+  // Minkowski product
+  inline double minkowskiProduct(const FourVector& a, const FourVector& b) {
+    return a[0]*b[0] - a[1]*b[1] - a[2]*b[2] - a[3]*b[3];
+  }
+
+  std::ostream& operator<<(std::ostream&, const FourVector&);
+
+} // namesapce bps
+
+#endif // BPS_4_VECTOR_H
@@ -0,0 +1,394 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_analysis.h"
+#include "bps_constants.h"
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  namespace {
+
+    // adds a thread's partial sums to the shared ones
+    void merge(std::vector<double>& total, const std::vector<double>& part) {
+      #pragma omp critical(bps_analysis_merge)
+      for (unsigned int i = 0; i < total.size(); i++)
+        total[i] += part[i];
+    }
+
+    double shellVolume(const double r0, const double r1) {
+      return 4*M_PI/3*(r1*r1*r1 - r0*r0*r0);
+    }
+
+    // Maxwell-Juettner distribution over the rapidity t (gamma = cosh t),
+    // unnormalized; cosh t - 1 = 2 sinh^2(t/2) avoids cancellation
+    double juettner(const double theta, const double t) {
+      const double s = std::sinh(t/2);
+      return std::pow(std::sinh(t), 2)*std::cosh(t)*std::exp(-2*s*s/theta);
+    }
+
+    // rapidity beyond which the distribution is negligible (e^-60)
+    double rapidityCutoff(const double theta) {
+      return 2*std::asinh(std::sqrt(30*theta));
+    }
+
+    // Simpson's rule for the distribution, optionally weighted with
+    // gamma - 1
+    double integrate(const double theta, double t0, double t1,
+                     const bool kinetic) {
+      t1 = std::min(t1, rapidityCutoff(theta));
+      if (t1 <= t0) return 0;
+
+      const int n = 256;
+      const double h = (t1 - t0)/n;
+      double sum = 0;
+      for (int i = 0; i <= n; i++) {
+        const double t = t0 + i*h;
+        double f = juettner(theta, t);
+        if (kinetic) f *= 2*std::pow(std::sinh(t/2), 2);
+        sum += (i == 0 || i == n ? 1 : i % 2 ? 4 : 2)*f;
+      }
+      return sum*h/3;
+    }
+
+    double checkedRmax(const double rmax, const int bins,
+                       const PeriodicBox& box) {
+      if (!(rmax > 0) || bins <= 0)
+        throw std::invalid_argument(
+            "RadialDistribution: rmax and bins must be positive");
+      for (int d = 0; d < 3; d++)
+        if (box.isPeriodic(d) && rmax > box.getLength(d)/2)
+          throw std::invalid_argument(
+              "RadialDistribution: rmax exceeds half the box");
+      return rmax;
+    }
+
+    double rapidity(const double v) {
+      const double beta = v/BPS_CONST_SPEED_OF_LIGHT;
+      return beta < 1 ? std::atanh(beta) : HUGE_VAL;
+    }
+
+  } // namespace
+
+  RadialDistribution::RadialDistribution(const double _rmax, const int bins,
+                                         const PeriodicBox& _box)
+          : rmax(checkedRmax(_rmax, bins, _box)), box(_box), pairs(bins, 0),
+            density(0), cells(_rmax, _box) {}
+
+  void RadialDistribution::reset() {
+    std::fill(pairs.begin(), pairs.end(), 0.0);
+    density = 0;
+  }
+
+  void RadialDistribution::accumulate(const ParticleArray& a) {
+    const int n = a.size();
+    if (n < 2) return;
+
+    points.resize(n);
+    for (int i = 0; i < n; i++)
+      points[i].position = ThreeVector(a.x[i], a.y[i], a.z[i]);
+    cells.build(points);
+
+    double volume = 1;
+    for (int d = 0; d < 3; d++) {
+      if (box.isPeriodic(d)) {
+        volume *= box.getLength(d);
+      } else {
+        const std::vector<double>& c = d == 0 ? a.x : d == 1 ? a.y : a.z;
+        volume *= *std::max_element(c.begin(), c.end())
+                  - *std::min_element(c.begin(), c.end());
+      }
+    }
+    if (volume > 0) density += 0.5*n*(n - 1)/volume;
+
+    const int bins = pairs.size();
+    const double rmax_square = rmax*rmax;
+
+    #pragma omp parallel
+    {
+      std::vector<double> part(bins, 0);
+      std::vector<int> neighbours;
+
+      #pragma omp for schedule(dynamic, 64)
+      for (int i = 0; i < n; i++) {
+        cells.neighbourCells(cells.cellOf(i), neighbours);
+        for (unsigned int c = 0; c < neighbours.size(); c++) {
+          for (int k = cells.cellBegin(neighbours[c]);
+               k < cells.cellEnd(neighbours[c]); k++) {
+            const int j = cells.cellParticle(k);
+            if (j <= i) continue;
+
+            const double dx = box.minimumImage(a.x[j] - a.x[i], 0);
+            const double dy = box.minimumImage(a.y[j] - a.y[i], 1);
+            const double dz = box.minimumImage(a.z[j] - a.z[i], 2);
+            const double r_square = dx*dx + dy*dy + dz*dz;
+            if (r_square >= rmax_square) continue;
+            const int b = static_cast<int>(std::sqrt(r_square)/rmax*bins);
+            part[std::min(b, bins - 1)]++;
+          }
+        }
+      }
+      merge(pairs, part);
+    }
+  }
+
+  void RadialDistribution::write(std::ostream& os) const {
+    const int bins = pairs.size();
+    const double width = rmax/bins;
+    os << "# radial distribution: r g(r) pairs" << std::endl;
+    for (int b = 0; b < bins; b++) {
+      const double ideal = density*shellVolume(b*width, (b + 1)*width);
+      os << (b + 0.5)*width << ' ' << (ideal > 0 ? pairs[b]/ideal : 0)
+         << ' ' << pairs[b] << std::endl;
+    }
+  }
+
+  RadialProfile::RadialProfile(const double _rmax, const int _bins)
+          : rmax(_rmax), bins(_bins), fixedCenter(false), snapshots(0),
+            sums(7*_bins, 0) {}
+
+  RadialProfile& RadialProfile::setCenter(const ThreeVector& _center) {
+    center = _center;
+    fixedCenter = true;
+    return *this;
+  }
+
+  void RadialProfile::reset() {
+    std::fill(sums.begin(), sums.end(), 0.0);
+    snapshots = 0;
+  }
+
+  void RadialProfile::accumulate(const ParticleArray& a) {
+    const int n = a.size();
+    snapshots++;
+
+    double c[3] = {center[0], center[1], center[2]};
+    if (!fixedCenter) {
+      double m = 0, cx = 0, cy = 0, cz = 0;
+      #pragma omp parallel for reduction(+:m,cx,cy,cz)
+      for (int i = 0; i < n; i++) {
+        m += a.mass[i];
+        cx += a.mass[i]*a.x[i];
+        cy += a.mass[i]*a.y[i];
+        cz += a.mass[i]*a.z[i];
+      }
+      if (m > 0) {
+        c[0] = cx/m;
+        c[1] = cy/m;
+        c[2] = cz/m;
+      }
+    }
+
+    #pragma omp parallel
+    {
+      std::vector<double> part(7*bins, 0);
+
+      #pragma omp for
+      for (int i = 0; i < n; i++) {
+        const double dx = a.x[i] - c[0];
+        const double dy = a.y[i] - c[1];
+        const double dz = a.z[i] - c[2];
+        const double r = std::sqrt(dx*dx + dy*dy + dz*dz);
+        if (r >= rmax) continue;
+
+        double* s = &part[7*std::min(static_cast<int>(r/rmax*bins),
+                                     bins - 1)];
+        s[0]++;
+        s[1] += a.mass[i];
+        s[2] += a.vx[i];
+        s[3] += a.vy[i];
+        s[4] += a.vz[i];
+        s[5] += a.vx[i]*a.vx[i] + a.vy[i]*a.vy[i] + a.vz[i]*a.vz[i];
+        if (r > 0) s[6] += (a.vx[i]*dx + a.vy[i]*dy + a.vz[i]*dz)/r;
+      }
+      merge(sums, part);
+    }
+  }
+
+  void RadialProfile::write(std::ostream& os) const {
+    const double width = rmax/bins;
+    os << "# radial profile: r number-density mass-density v_r sigma"
+       << std::endl;
+    for (int b = 0; b < bins; b++) {
+      const double* s = &sums[7*b];
+      const double volume = shellVolume(b*width, (b + 1)*width)
+                            *std::max(1, snapshots);
+      double vr = 0, sigma = 0;
+      if (s[0] > 0) {
+        const double mx = s[2]/s[0], my = s[3]/s[0], mz = s[4]/s[0];
+        vr = s[6]/s[0];
+        sigma = std::sqrt(std::max(0.0, (s[5]/s[0] - mx*mx - my*my - mz*mz)
+                                        /3));
+      }
+      os << (b + 0.5)*width << ' ' << s[0]/volume << ' ' << s[1]/volume
+         << ' ' << vr << ' ' << sigma << std::endl;
+    }
+  }
+
+  SpeedDistribution::SpeedDistribution(const double _mass, const int bins,
+                                       const double _vmax,
+                                       const double _temperature)
+          : mass(_mass), vmax(_vmax), temperature(_temperature),
+            counts(bins + 1, 0), kinetic(0), skipped(0) {}
+
+  void SpeedDistribution::reset() {
+    std::fill(counts.begin(), counts.end(), 0.0);
+    kinetic = 0;
+    skipped = 0;
+  }
+
+  void SpeedDistribution::accumulate(const ParticleArray& a) {
+    const int n = a.size();
+    const int bins = counts.size() - 1;
+    const double inverse_c_square = 1/(BPS_CONST_SPEED_OF_LIGHT
+                                       *BPS_CONST_SPEED_OF_LIGHT);
+    double sum = 0, faster = 0;
+
+    #pragma omp parallel reduction(+:sum,faster)
+    {
+      std::vector<double> part(bins + 1, 0);
+
+      #pragma omp for
+      for (int i = 0; i < n; i++) {
+        if (a.mass[i] != mass) continue;
+
+        const double v_square = a.vx[i]*a.vx[i] + a.vy[i]*a.vy[i]
+                                + a.vz[i]*a.vz[i];
+        const double beta_square = v_square*inverse_c_square;
+        if (!(beta_square < 1)) {
+          faster++;
+          continue;
+        }
+        const double v = std::sqrt(v_square);
+        part[std::min(static_cast<int>(v/vmax*bins), bins)]++;
+
+        // gamma - 1 = (gamma beta)^2/(gamma + 1)
+        const double gamma = 1/std::sqrt(1 - beta_square);
+        sum += beta_square/(1 - beta_square)/(gamma + 1);
+      }
+      merge(counts, part);
+    }
+    kinetic += sum;
+    skipped += faster;
+  }
+
+  void SpeedDistribution::write(std::ostream& os) const {
+    const int bins = counts.size() - 1;
+    double total = 0;
+    for (int b = 0; b <= bins; b++)
+      total += counts[b];
+
+    const double rest = mass*BPS_CONST_SPEED_OF_LIGHT
+                        *BPS_CONST_SPEED_OF_LIGHT;
+    double theta = temperature*BPS_CONST_BOLTZMANN/rest;
+    if (temperature <= 0 && total > 0) theta = fitTheta(kinetic/total);
+
+    // total variation distance between histogram and distribution
+    double distance = 0;
+    std::vector<double> expected(bins + 1);
+    for (int b = 0; b <= bins; b++) {
+      const double v0 = b*vmax/bins;
+      const double v1 = b < bins ? (b + 1)*vmax/bins : HUGE_VAL;
+      expected[b] = theta > 0 ? fraction(theta, v0, v1) : 0;
+      distance += 0.5*std::fabs((total > 0 ? counts[b]/total : 0)
+                                - expected[b]);
+    }
+
+    os << "# speed distribution: T " << theta*rest/BPS_CONST_BOLTZMANN
+       << " K, distance to Maxwell-Juettner " << distance << ", "
+       << skipped << " skipped at v >= c" << std::endl;
+    os << "# v fraction maxwell-juettner (last row: v >= vmax)" << std::endl;
+    for (int b = 0; b <= bins; b++)
+      os << (b < bins ? (b + 0.5)*vmax/bins : vmax) << ' '
+         << (total > 0 ? counts[b]/total : 0) << ' ' << expected[b]
+         << std::endl;
+  }
+
+  double SpeedDistribution::fitTheta(const double meanKinetic) {
+    if (meanKinetic <= 0) return 0;
+
+    // the mean of gamma - 1 grows with theta; bisect on log(theta)
+    double low = std::log(1e-30), high = std::log(1e6);
+    for (int i = 0; i < 80; i++) {
+      const double theta = std::exp(0.5*(low + high));
+      const double cutoff = rapidityCutoff(theta);
+      const double mean = integrate(theta, 0, cutoff, true)
+                          /integrate(theta, 0, cutoff, false);
+      if (mean < meanKinetic)
+        low = std::log(theta);
+      else
+        high = std::log(theta);
+    }
+    return std::exp(0.5*(low + high));
+  }
+
+  double SpeedDistribution::fraction(const double theta, const double v0,
+                                     const double v1) {
+    return integrate(theta, rapidity(v0), rapidity(v1), false)
+           /integrate(theta, 0, rapidityCutoff(theta), false);
+  }
+
+  Analysis::Analysis(std::ostream& _os, const int _interval)
+          : os(_os), interval(std::max(1, _interval)), snapshots(0),
+            firstStep(0), lastStep(0) {}
+
+  Analysis& Analysis::add(Reducer& reducer) {
+    reducers.push_back(&reducer);
+    return *this;
+  }
+
+  Analysis& Analysis::accumulate(const ParticleArray& particles,
+                                 const int step) {
+    if (snapshots == 0) firstStep = step;
+    lastStep = step;
+    for (unsigned int r = 0; r < reducers.size(); r++)
+      reducers[r]->accumulate(particles);
+    if (++snapshots == interval) flush();
+    return *this;
+  }
+
+  Analysis& Analysis::flush() {
+    if (snapshots == 0) return *this;
+
+    os << "# steps " << firstStep << " to " << lastStep << ", " << snapshots
+       << " snapshots" << std::endl;
+    for (unsigned int r = 0; r < reducers.size(); r++) {
+      reducers[r]->write(os);
+      reducers[r]->reset();
+    }
+    os << std::endl;
+    snapshots = 0;
+    return *this;
+  }
+
+  void Analysis::observe(const ParticleArray& snapshot, const int step,
+                         void* analysis) {
+    static_cast<Analysis*>(analysis)->accumulate(snapshot, step);
+  }
+
+} // namespace bps
@@ -0,0 +1,164 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_ANALYSIS_H
+#define BPS_ANALYSIS_H
+
+#include <ostream>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  // Statistic that is updated with one snapshot at a time and summarized
+  // afterwards, so the particles themselves never need to be written out.
+  // Reducers fill per-thread partial results in parallel and merge them at
+  // the end of each accumulate call. Inside an OpenMP task, e.g. as
+  // StepPipeline diagnostics, the team is a single thread and they run
+  // serially, overlapped with the other stages instead.
+  class Reducer {
+    public:
+      virtual ~Reducer() {}
+
+      // forgets all snapshots
+      virtual void reset() = 0;
+
+      virtual void accumulate(const ParticleArray& particles) = 0;
+
+      // summary of the snapshots since the last reset, one table row per
+      // line after a "#" header
+      virtual void write(std::ostream& os) const = 0;
+  };
+
+  // Radial distribution function g(r) for 0 <= r < rmax. In periodic
+  // directions the nearest image is used and the box length gives the
+  // volume; in open ones the extent of the particles does. rmax has to be
+  // positive and at most L/2 in periodic directions, and bins positive,
+  // otherwise the constructor throws std::invalid_argument.
+  class RadialDistribution : public Reducer {
+    protected:
+      double rmax;
+      PeriodicBox box;
+      std::vector<double> pairs;
+      double density;  // sum of N(N-1)/(2V) over the snapshots
+
+      // reused between snapshots
+      std::vector<Particle> points;
+      CellList cells;
+
+    public:
+      RadialDistribution(const double _rmax, const int bins,
+                         const PeriodicBox& _box = PeriodicBox());
+
+      void reset();
+      void accumulate(const ParticleArray& particles);
+      void write(std::ostream& os) const;
+  };
+
+  // Number and mass density, mean radial velocity and (one-dimensional)
+  // velocity dispersion in spherical shells around the center of mass of
+  // each snapshot, or around a fixed center.
+  class RadialProfile : public Reducer {
+    protected:
+      double rmax;
+      int bins;
+      bool fixedCenter;
+      ThreeVector center;
+      int snapshots;
+
+      // per bin: count, mass, v_x, v_y, v_z, v^2, v_r
+      std::vector<double> sums;
+
+    public:
+      RadialProfile(const double _rmax, const int _bins);
+
+      RadialProfile& setCenter(const ThreeVector& _center);
+
+      void reset();
+      void accumulate(const ParticleArray& particles);
+      void write(std::ostream& os) const;
+  };
+
+  // Histogram of the speeds of the particles of the given mass, compared
+  // with the Maxwell-Juettner distribution of the given temperature (K) or,
+  // if it is 0, of the temperature that matches their mean kinetic energy.
+  // Particles at or beyond the speed of light (or with NaN velocities)
+  // have no kinetic energy; they are left out and counted separately.
+  class SpeedDistribution : public Reducer {
+    protected:
+      double mass;
+      double vmax;
+      double temperature;
+      std::vector<double> counts;  // the last bin counts v >= vmax
+      double kinetic;              // sum of gamma - 1
+      double skipped;              // particles with v >= c
+
+    public:
+      SpeedDistribution(const double _mass, const int bins,
+                        const double _vmax, const double _temperature = 0);
+
+      void reset();
+      void accumulate(const ParticleArray& particles);
+      void write(std::ostream& os) const;
+
+      // particles left out since the last reset
+      inline double getSkipped() const { return skipped; }
+
+      // kT/(mc^2) of the Maxwell-Juettner distribution with the given mean
+      // gamma - 1
+      static double fitTheta(const double meanKinetic);
+
+      // fraction of a Maxwell-Juettner distribution between two speeds
+      static double fraction(const double theta, const double v0,
+                             const double v1);
+  };
+
+  // In-situ analysis stage: feeds snapshots to a set of reducers and
+  // writes their summaries every interval snapshots. observe() fits
+  // StepPipeline::setDiagnostics, where the reducers run on one thread
+  // (see Reducer).
+  class Analysis {
+    protected:
+      std::ostream& os;
+      int interval;
+      std::vector<Reducer*> reducers;
+      int snapshots;
+      int firstStep, lastStep;
+
+    public:
+      Analysis(std::ostream& _os, const int _interval = 1);
+
+      Analysis& add(Reducer& reducer);
+
+      Analysis& accumulate(const ParticleArray& particles, const int step);
+
+      // writes the summaries of the snapshots so far and resets
+      Analysis& flush();
+
+      static void observe(const ParticleArray& snapshot, const int step,
+                          void* analysis);
+  };
+
+} // namespace bps
+
+#endif // BPS_ANALYSIS_H
@@ -0,0 +1,100 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "bps_boris.h"
+#include "bps_constants.h"
+#include "bps_field.h"
+#include "bps_kernels.h"
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  namespace {
+
+    // particles per task, small enough to keep the field values of a
+    // block in cache until the kernel reads them
+    const int pushBlock = 256;
+
+  } // namespace
+
+  BorisPusher::BorisPusher(const ElectromagneticField& _field, const double t)
+          : field(_field), time(t) {}
+
+  BorisPusher& BorisPusher::push(ParticleArray& a, const double dt) {
+    const int n = a.size();
+    if (n == 0) {
+      time += dt;
+      return *this;
+    }
+
+    for (int d = 0; d < 3; d++) {
+      e[d].resize(n);
+      b[d].resize(n);
+      // another number of particles starts over from the velocities
+      if (static_cast<int>(u[d].size()) != n) {
+        u[d].assign(n, 0);
+        written[d].assign(n, std::numeric_limits<double>::quiet_NaN());
+      }
+    }
+    const double inverse_c_square = 1/(BPS_CONST_SPEED_OF_LIGHT
+                                       *BPS_CONST_SPEED_OF_LIGHT);
+
+    const Kernels::Table& kernels = Kernels::table();
+
+    #pragma omp parallel for schedule(static)
+    for (int begin = 0; begin < n; begin += pushBlock) {
+      const int m = std::min(n - begin, pushBlock);
+
+      // u of the last push, unless the velocities have been changed since
+      for (int i = begin; i < begin + m; i++) {
+        if (a.vx[i] == written[0][i] && a.vy[i] == written[1][i]
+            && a.vz[i] == written[2][i])
+          continue;
+        const double v_square = a.vx[i]*a.vx[i] + a.vy[i]*a.vy[i]
+                                + a.vz[i]*a.vz[i];
+        const double gamma = 1/std::sqrt(1 - v_square*inverse_c_square);
+        u[0][i] = gamma*a.vx[i];
+        u[1][i] = gamma*a.vy[i];
+        u[2][i] = gamma*a.vz[i];
+      }
+
+      field.evaluate(m, &a.x[begin], &a.y[begin], &a.z[begin], time,
+                     &e[0][begin], &e[1][begin], &e[2][begin],
+                     &b[0][begin], &b[1][begin], &b[2][begin]);
+      kernels.borisPush(m, dt, &a.charge[begin], &a.mass[begin],
+                        &e[0][begin], &e[1][begin], &e[2][begin],
+                        &b[0][begin], &b[1][begin], &b[2][begin],
+                        &a.x[begin], &a.y[begin], &a.z[begin],
+                        &u[0][begin], &u[1][begin], &u[2][begin],
+                        &a.vx[begin], &a.vy[begin], &a.vz[begin]);
+
+      std::copy(&a.vx[begin], &a.vx[begin] + m, &written[0][begin]);
+      std::copy(&a.vy[begin], &a.vy[begin] + m, &written[1][begin]);
+      std::copy(&a.vz[begin], &a.vz[begin] + m, &written[2][begin]);
+    }
+
+    time += dt;
+    return *this;
+  }
+
+} // namespace bps
@@ -0,0 +1,69 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_BORIS_H
+#define BPS_BORIS_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_field.h"
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  // Relativistic Boris integrator for charged particles in an external
+  // field. It is a leapfrog scheme: when push is called the positions are
+  // at the current time and the velocities half a step earlier. The
+  // particles do not interact; the dv member is left untouched.
+  //
+  // The pusher integrates the momenta per mass u = gamma v and keeps them
+  // between pushes; the velocities of the array are derived from them.
+  // Computing gamma from v instead would lose digits like 1 - v^2/c^2,
+  // i.e. a relative error of about 1e-16 gamma^2 per step. Velocities
+  // changed by the caller between pushes are noticed and u is computed
+  // from them again.
+  class BorisPusher {
+    protected:
+      const ElectromagneticField& field;
+      double time;
+
+      // field values at the particle positions, reused between steps
+      std::vector<double> e[3], b[3];
+
+      // u of the particles and the velocities written with it
+      std::vector<double> u[3], written[3];
+
+    public:
+      BorisPusher(const ElectromagneticField& _field, const double t = 0);
+
+      inline double getTime() const { return time; }
+      inline BorisPusher& setTime(const double t) { time = t; return *this; }
+
+      // advances all particles by dt
+      BorisPusher& push(ParticleArray& particles, const double dt);
+
+      // u = gamma v of the i-th particle after the last push
+      inline ThreeVector getMomentum(const int i) const {
+        return ThreeVector(u[0][i], u[1][i], u[2][i]);
+      }
+  };
+
+} // namespace bps
+
+#endif // BPS_BORIS_H
@@ -0,0 +1,418 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "bps_checkpoint.h"
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  namespace {
+
+    const char magic[4] = {'B', 'P', 'S', 'C'};
+    const int version = 1;
+    enum Kind { Full, Delta };
+
+    // all arrays of a ParticleArray, in file order
+    const int arrayCount = 11;
+    std::vector<double> ParticleArray::* const arrays[arrayCount] = {
+      &ParticleArray::x, &ParticleArray::y, &ParticleArray::z,
+      &ParticleArray::vx, &ParticleArray::vy, &ParticleArray::vz,
+      &ParticleArray::dvx, &ParticleArray::dvy, &ParticleArray::dvz,
+      &ParticleArray::mass, &ParticleArray::charge
+    };
+
+    std::string fileName(const std::string& prefix, const long long sequence) {
+      char number[32];
+      std::sprintf(number, "-%06lld.ckpt", sequence);
+      return prefix + number;
+    }
+
+    std::string indexName(const std::string& prefix) {
+      return prefix + ".index";
+    }
+
+    // flushes f to the disk and closes it
+    bool syncAndClose(std::FILE* f) {
+      const bool synced = std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+      return std::fclose(f) == 0 && synced;
+    }
+
+    // makes renames in the directory of path durable
+    bool syncDirectory(const std::string& path) {
+      const std::string::size_type slash = path.rfind('/');
+      const std::string directory = slash == std::string::npos ? "."
+        : slash == 0 ? "/" : path.substr(0, slash);
+      const int fd = open(directory.c_str(), O_RDONLY);
+      if (fd < 0) return false;
+      const bool synced = fsync(fd) == 0;
+      return close(fd) == 0 && synced;
+    }
+
+    bool readIndex(const std::string& prefix, long long& base,
+                   long long& latest) {
+      std::FILE* f = std::fopen(indexName(prefix).c_str(), "r");
+      if (!f) return false;
+      const bool ok = std::fscanf(f, "%lld %lld", &base, &latest) == 2;
+      std::fclose(f);
+      return ok;
+    }
+
+    // word-wise FNV-1a, fast enough to check whole checkpoints
+    class Hash {
+      protected:
+        unsigned long long h;
+
+      public:
+        Hash() : h(0xcbf29ce484222325ULL) {}
+
+        void add(const void* data, const size_t n) {
+          const unsigned char* p = static_cast<const unsigned char*>(data);
+          size_t i = 0;
+          for (; i + 8 <= n; i += 8) {
+            unsigned long long w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w)*0x100000001b3ULL;
+          }
+          for (; i < n; i++)
+            h = (h ^ p[i])*0x100000001b3ULL;
+        }
+
+        unsigned long long value() const { return h; }
+    };
+
+    class Output {
+      protected:
+        std::FILE* f;
+        Hash hash;
+
+      public:
+        bool ok;
+
+        Output(std::FILE* _f) : f(_f), ok(true) {}
+
+        void put(const void* data, const size_t n) {
+          hash.add(data, n);
+          ok = ok && std::fwrite(data, 1, n, f) == n;
+        }
+
+        void putChecksum() {
+          const unsigned long long h = hash.value();
+          ok = ok && std::fwrite(&h, 8, 1, f) == 1;
+        }
+    };
+
+    class Input {
+      protected:
+        std::FILE* f;
+        Hash hash;
+        long size;
+
+      public:
+        bool ok;
+
+        Input(std::FILE* _f) : f(_f), size(0), ok(true) {
+          ok = std::fseek(f, 0, SEEK_END) == 0 && (size = std::ftell(f)) >= 0
+               && std::fseek(f, 0, SEEK_SET) == 0;
+        }
+
+        // bytes not read yet, to bound what a corrupt header may allocate
+        long long remaining() const {
+          const long position = std::ftell(f);
+          return position < 0 ? 0 : size - position;
+        }
+
+        void get(void* data, const size_t n) {
+          ok = ok && std::fread(data, 1, n, f) == n;
+          if (ok) hash.add(data, n);
+        }
+
+        bool checksum() {
+          unsigned long long h;
+          return ok && std::fread(&h, 8, 1, f) == 1 && h == hash.value();
+        }
+    };
+
+    int leadingZeroBytes(const unsigned long long w) {
+      return w == 0 ? 8 : __builtin_clzll(w)/8;
+    }
+
+    // Appends a XOR b: for every pair of words one byte with their numbers
+    // of leading zero bytes (low nibble first word), followed by the
+    // remaining low-order bytes of both words.
+    void encode(const double* a, const double* b, const long long n,
+                std::vector<unsigned char>& out) {
+      out.resize(n*8 + (n + 1)/2);
+      unsigned char* p = &out[0];
+      for (long long i = 0; i < n; i += 2) {
+        unsigned long long w[2] = {0, 0};
+        int zeros[2] = {8, 8};
+        for (int k = 0; k < 2 && i + k < n; k++) {
+          unsigned long long u, v;
+          std::memcpy(&u, a + i + k, 8);
+          std::memcpy(&v, b + i + k, 8);
+          w[k] = u ^ v;
+          zeros[k] = leadingZeroBytes(w[k]);
+        }
+        *p++ = zeros[0] | zeros[1] << 4;
+        for (int k = 0; k < 2; k++) {
+          for (int j = 0; j < 8 - zeros[k]; j++)
+            *p++ = (w[k] >> 8*j) & 0xff;
+        }
+      }
+      out.resize(p - &out[0]);
+    }
+
+    // a = b XOR (decoded words); false if the data are malformed
+    bool decode(const std::vector<unsigned char>& in, const double* b,
+                double* a, const long long n) {
+      const unsigned char* p = in.empty() ? 0 : &in[0];
+      const unsigned char* end = p + in.size();
+      for (long long i = 0; i < n; i += 2) {
+        if (p == end) return false;
+        const int zeros[2] = {*p & 0xf, *p >> 4};
+        p++;
+        for (int k = 0; k < 2; k++) {
+          if (zeros[k] > 8 || end - p < 8 - zeros[k]) return false;
+          unsigned long long w = 0;
+          for (int j = 0; j < 8 - zeros[k]; j++)
+            w |= static_cast<unsigned long long>(*p++) << 8*j;
+          if (i + k >= n) continue;
+
+          unsigned long long v;
+          std::memcpy(&v, b + i + k, 8);
+          v ^= w;
+          std::memcpy(a + i + k, &v, 8);
+        }
+      }
+      return p == end;
+    }
+
+    // reads a checkpoint file; deltas are applied to particles, which must
+    // hold their base
+    bool readFile(const std::string& name, const long long sequence,
+                  const long long baseSequence, ParticleArray& particles,
+                  RunState& s) {
+      std::FILE* f = std::fopen(name.c_str(), "rb");
+      if (!f) return false;
+      Input in(f);
+
+      char m[4];
+      int header[2];
+      long long numbers[3];
+      in.get(m, 4);
+      in.get(header, sizeof(header));
+      in.get(numbers, sizeof(numbers));
+      const int kind = header[1];
+      bool ok = in.ok && std::memcmp(m, magic, 4) == 0
+                && header[0] == version && numbers[0] == sequence
+                && numbers[1] == baseSequence
+                && (kind == Full) == (sequence == baseSequence);
+      const long long n = numbers[2];
+      if (ok && kind == Delta) ok = particles.size() == n;
+
+      long long wordCount = 0;
+      if (ok) {
+        in.get(&s.step, 8);
+        in.get(&s.time, 8);
+        in.get(&s.dt, 8);
+        in.get(&wordCount, 8);
+        ok = in.ok && wordCount >= 0 && wordCount <= in.remaining()/8;
+      }
+      if (ok) {
+        s.words.resize(wordCount);
+        if (wordCount > 0) in.get(&s.words[0], 8*wordCount);
+      }
+
+      if (ok && kind == Full)
+        ok = n >= 0 && n <= in.remaining()/(8*arrayCount);
+      if (ok && kind == Full) particles.resize(n);
+      std::vector<unsigned char> data;
+      for (int k = 0; ok && k < arrayCount; k++) {
+        std::vector<double>& v = particles.*arrays[k];
+        if (kind == Full) {
+          if (n > 0) in.get(&v[0], 8*n);
+        } else {
+          long long size = 0;
+          in.get(&size, 8);
+          ok = in.ok && size >= 0 && size <= 9*n + 1;
+          if (ok) {
+            data.resize(size);
+            if (size > 0) in.get(&data[0], size);
+            ok = in.ok && (n == 0 || decode(data, &v[0], &v[0], n));
+          }
+        }
+        ok = ok && in.ok;
+      }
+
+      ok = ok && in.checksum();
+      std::fclose(f);
+      return ok;
+    }
+
+  } // namespace
+
+  Checkpoint::Checkpoint(const std::string& _prefix, const int _baseInterval)
+          : prefix(_prefix), baseInterval(_baseInterval), sequence(0),
+            baseSequence(-1), oldest(0), writing(-1), full(false),
+            running(false), failed(false) {
+    long long base, latest;
+    if (readIndex(prefix, base, latest)) {
+      sequence = latest + 1;
+      oldest = base;
+    }
+  }
+
+  Checkpoint::~Checkpoint() {
+    join();
+  }
+
+  Checkpoint& Checkpoint::write(const ParticleArray& particles,
+                                const RunState& s) {
+    // a failure of the previous write stays set for wait()
+    join();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < arrayCount; k++)
+      snapshot.*arrays[k] = particles.*arrays[k];
+    state = s;
+
+    writing = sequence++;
+    full = baseSequence < 0 || writing - baseSequence >= baseInterval
+           || base.size() != snapshot.size();
+
+    running = pthread_create(&thread, 0, work, this) == 0;
+    if (!running && !writeFile()) failed = true;
+    return *this;
+  }
+
+  bool Checkpoint::wait() {
+    join();
+    const bool ok = !failed;
+    failed = false;
+    return ok;
+  }
+
+  void Checkpoint::join() {
+    if (running) {
+      pthread_join(thread, 0);
+      running = false;
+    }
+  }
+
+  void* Checkpoint::work(void* checkpoint) {
+    Checkpoint* c = static_cast<Checkpoint*>(checkpoint);
+    if (!c->writeFile()) c->failed = true;
+    return 0;
+  }
+
+  bool Checkpoint::writeFile() {
+    const std::string name = fileName(prefix, writing);
+    const std::string temporary = name + ".tmp";
+    const long long n = snapshot.size();
+    const long long reference = full ? writing : baseSequence;
+
+    std::FILE* f = std::fopen(temporary.c_str(), "wb");
+    if (!f) return false;
+    Output out(f);
+
+    const int header[2] = {version, full ? Full : Delta};
+    const long long numbers[3] = {writing, reference, n};
+    const long long wordCount = state.words.size();
+    out.put(magic, 4);
+    out.put(header, sizeof(header));
+    out.put(numbers, sizeof(numbers));
+    out.put(&state.step, 8);
+    out.put(&state.time, 8);
+    out.put(&state.dt, 8);
+    out.put(&wordCount, 8);
+    if (wordCount > 0) out.put(&state.words[0], 8*wordCount);
+
+    for (int k = 0; k < arrayCount; k++) {
+      const std::vector<double>& v = snapshot.*arrays[k];
+      if (full) {
+        if (n > 0) out.put(&v[0], 8*n);
+      } else {
+        if (n > 0) encode(&v[0], &(base.*arrays[k])[0], n, buffer);
+        else buffer.clear();
+        const long long size = buffer.size();
+        out.put(&size, 8);
+        if (size > 0) out.put(&buffer[0], size);
+      }
+    }
+    out.putChecksum();
+
+    // the data have to be on the disk before the rename is, otherwise a
+    // crash could leave a complete name with incomplete contents
+    const bool closed = syncAndClose(f);
+    if (!out.ok || !closed ||
+        std::rename(temporary.c_str(), name.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return false;
+    }
+    if (!syncDirectory(name)) return false;
+
+    // publish the checkpoint
+    const std::string index = indexName(prefix);
+    f = std::fopen((index + ".tmp").c_str(), "w");
+    if (!f) return false;
+    const bool written = std::fprintf(f, "%lld %lld\n", reference,
+                                      writing) > 0;
+    if (!syncAndClose(f) || !written ||
+        std::rename((index + ".tmp").c_str(), index.c_str()) != 0 ||
+        !syncDirectory(index))
+      return false;
+
+    if (full) {
+      // the new base replaces the last one and its deltas
+      for (long long q = oldest; q < writing; q++)
+        std::remove(fileName(prefix, q).c_str());
+      oldest = writing;
+      baseSequence = writing;
+      for (int k = 0; k < arrayCount; k++)
+        (base.*arrays[k]).swap(snapshot.*arrays[k]);
+    }
+    return true;
+  }
+
+  bool Checkpoint::restore(const std::string& prefix,
+                           ParticleArray& particles, RunState& s) {
+    long long base, latest;
+    if (!readIndex(prefix, base, latest)) return false;
+
+    ParticleArray a;
+    RunState r;
+    if (!readFile(fileName(prefix, base), base, base, a, r)) return false;
+    if (latest != base &&
+        !readFile(fileName(prefix, latest), latest, base, a, r))
+      return false;
+
+    for (int k = 0; k < arrayCount; k++)
+      (particles.*arrays[k]).swap(a.*arrays[k]);
+    s = r;
+    return true;
+  }
+
+} // namespace bps
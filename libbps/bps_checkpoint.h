@@ -0,0 +1,105 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_CHECKPOINT_H
+#define BPS_CHECKPOINT_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  // Integrator state stored with the particles.
+  struct RunState {
+    long long step;
+    double time;
+    double dt;
+    std::vector<unsigned long long> words;  // anything else, e.g. RNG state
+
+    RunState() : step(0), time(0), dt(0) {}
+  };
+
+  // Checkpoints of a ParticleArray (all members including dv) and a
+  // RunState, written to the files <prefix>-<sequence>.ckpt.
+  //
+  // Every baseInterval-th checkpoint is a full one; the ones in between
+  // store only the XOR of each 64-bit word with the last full checkpoint,
+  // with the leading zero bytes dropped. Since the sign, exponent and high
+  // mantissa bits of slowly changing values stay the same, and masses and
+  // charges do not change at all, deltas are much smaller than the state.
+  //
+  // write() copies the particles and returns; the checkpoint is encoded
+  // and written by a background thread, and a failure is reported by the
+  // next wait(), also if other writes came in between. Files are written
+  // under a temporary name, synced to the disk and renamed when complete;
+  // then <prefix>.index is updated the same way, so a restart (also after
+  // a crash of the machine) never sees a partial checkpoint. Once a new
+  // full checkpoint is complete the files of the previous one are removed.
+  // Restoring gives back the saved values bit for bit. The files use the
+  // byte order of the machine.
+  class Checkpoint {
+    protected:
+      std::string prefix;
+      int baseInterval;
+      long long sequence;      // of the next checkpoint
+      long long baseSequence;  // of the last full checkpoint, or -1
+      long long oldest;        // first checkpoint that may still exist
+      long long writing;       // the one in progress
+
+      // the last full checkpoint and the one being written
+      ParticleArray base, snapshot;
+      RunState state;
+      bool full;
+      std::vector<unsigned char> buffer;  // encoded deltas
+
+      pthread_t thread;
+      bool running;
+      bool failed;  // a write failed since the last wait()
+
+      static void* work(void* checkpoint);
+      void join();
+      bool writeFile();
+
+      // not copyable, the background thread works on this object
+      Checkpoint(const Checkpoint&);
+      Checkpoint& operator=(const Checkpoint&);
+
+    public:
+      // continues the numbering of an existing index with the same prefix
+      Checkpoint(const std::string& _prefix, const int _baseInterval = 10);
+      ~Checkpoint();
+
+      Checkpoint& write(const ParticleArray& particles, const RunState& s);
+
+      // waits for the background write; false if it or any other write
+      // since the last call failed
+      bool wait();
+
+      inline long long getSequence() const { return sequence; }
+
+      // loads the latest complete checkpoint with the given prefix
+      static bool restore(const std::string& prefix, ParticleArray& particles,
+                          RunState& s);
+  };
+
+} // namespace bps
+
+#endif // BPS_CHECKPOINT_H
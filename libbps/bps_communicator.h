@@ -0,0 +1,65 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_COMMUNICATOR_H
+#define BPS_COMMUNICATOR_H
+
+#include <vector>
+
+namespace bps {
+
+  // The few collective operations the domain decomposition needs. Every
+  // rank has to call them in the same order.
+  class Communicator {
+    public:
+      virtual ~Communicator() {}
+
+      virtual int rank() const = 0;
+      virtual int size() const = 0;
+
+      // element-wise reductions over all ranks, in place
+      virtual void sum(double* values, const int n) const = 0;
+      virtual void min(double* values, const int n) const = 0;
+      virtual void max(double* values, const int n) const = 0;
+
+      // sends[r] goes to rank r, receives[r] is what rank r sent here
+      virtual void exchange(const std::vector<std::vector<double> >& sends,
+                            std::vector<std::vector<double> >& receives)
+              const = 0;
+  };
+
+  // Communicator of a single process.
+  class SerialCommunicator : public Communicator {
+    public:
+      inline int rank() const { return 0; }
+      inline int size() const { return 1; }
+
+      inline void sum(double*, const int) const {}
+      inline void min(double*, const int) const {}
+      inline void max(double*, const int) const {}
+
+      inline void exchange(const std::vector<std::vector<double> >& sends,
+                           std::vector<std::vector<double> >& receives)
+              const {
+        receives = sends;
+      }
+  };
+
+} // namespace bps
+
+#endif // BPS_COMMUNICATOR_H
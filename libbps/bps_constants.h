@@ -27,5 +27,6 @@
 #define BPS_CONST_MASS_NEUTRON (1.6749271613e-27) // kg
 #define BPS_CONST_MASS_ELECTRON (9.1093818872e-31) // kg
 #define BPS_CONST_ELEMENTARY_CHARGE (1.60217653e-19) // A s
+#define BPS_CONST_BOLTZMANN (1.3806505e-23) // kg m^2 s^-2 K^-1
 
 #endif // BPS_CONSTANTS_H
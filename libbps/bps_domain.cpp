@@ -0,0 +1,341 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_communicator.h"
+#include "bps_domain.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+
+namespace bps {
+
+  namespace {
+
+    // number of doubles per particle in messages
+    const int particleSize = 11;
+
+    void pack(const Particle& p, std::vector<double>& buffer) {
+      for (int d = 0; d < 3; d++)
+        buffer.push_back(p.position[d]);
+      for (int d = 0; d < 3; d++)
+        buffer.push_back(p.velocity[d]);
+      for (int d = 0; d < 3; d++)
+        buffer.push_back(p.dv[d]);
+      buffer.push_back(p.mass);
+      buffer.push_back(p.charge);
+    }
+
+    void unpack(const std::vector<double>& buffer,
+                std::vector<Particle>& particles) {
+      for (unsigned int k = 0; k + particleSize <= buffer.size();
+           k += particleSize) {
+        const double* b = &buffer[k];
+        Particle p(ThreeVector(b[0], b[1], b[2]),
+                   ThreeVector(b[3], b[4], b[5]), b[9], b[10]);
+        p.dv.set(b[6], b[7], b[8]);
+        particles.push_back(p);
+      }
+    }
+
+    // rounds of the bisection search for a cut position
+    const int cutIterations = 60;
+
+    // all of space: [0, L) along periodic directions, unbounded otherwise
+    void space(const PeriodicBox& box, ThreeVector& low, ThreeVector& high) {
+      for (int d = 0; d < 3; d++) {
+        low[d] = box.isPeriodic(d) ? 0 : -HUGE_VAL;
+        high[d] = box.isPeriodic(d) ? box.getLength(d) : HUGE_VAL;
+      }
+    }
+
+  } // namespace
+
+  DomainDecomposition::DomainDecomposition(const Communicator& _comm,
+                                           const PeriodicBox& _box)
+          : comm(_comm), box(_box), migrated(true) {
+    // until the first partition, rank 0 owns all of space
+    Node root = {0, 0, -1, -1, 0};
+    nodes.push_back(root);
+    lower.assign(comm.size(), ThreeVector(HUGE_VAL, HUGE_VAL, HUGE_VAL));
+    upper.assign(comm.size(), ThreeVector(-HUGE_VAL, -HUGE_VAL, -HUGE_VAL));
+    space(box, lower[0], upper[0]);
+  }
+
+  int DomainDecomposition::bisect(const std::vector<Particle>& particles,
+                                  std::vector<int>& indices,
+                                  const int rankBegin, const int rankEnd,
+                                  const ThreeVector& low,
+                                  const ThreeVector& high) {
+    const int index = nodes.size();
+    Node node = {0, 0, -1, -1, rankBegin};
+    nodes.push_back(node);
+
+    if (rankEnd - rankBegin == 1) {
+      lower[rankBegin] = low;
+      upper[rankBegin] = high;
+      return index;
+    }
+
+    // extent of the particles inside this domain; the upper bounds are
+    // negated so a single min reduction finds all six values
+    double extent[6];
+    for (int d = 0; d < 3; d++) {
+      extent[d] = HUGE_VAL;
+      extent[d+3] = HUGE_VAL;
+    }
+    for (unsigned int k = 0; k < indices.size(); k++) {
+      const ThreeVector& r = particles[indices[k]].position;
+      for (int d = 0; d < 3; d++) {
+        extent[d] = std::min(extent[d], r[d]);
+        extent[d+3] = std::min(extent[d+3], -r[d]);
+      }
+    }
+    comm.min(extent, 6);
+
+    int axis = 0;
+    double longest = -1;
+    for (int d = 0; d < 3; d++) {
+      const double length = -extent[d+3] - extent[d];
+      if (length > longest) {
+        longest = length;
+        axis = d;
+      }
+    }
+
+    const int rankMiddle = (rankBegin + rankEnd)/2;
+    double total = indices.size();
+    comm.sum(&total, 1);
+    const double target = total*(rankMiddle - rankBegin)
+                          /(rankEnd - rankBegin);
+
+    // smallest cut with at least target particles below it
+    double a = extent[axis];
+    double b = -extent[axis+3];
+    if (total == 0) a = b = 0;
+    for (int i = 0; i < cutIterations && a < b; i++) {
+      const double cut = (a + b)/2;
+      double count = 0;
+      for (unsigned int k = 0; k < indices.size(); k++)
+        if (particles[indices[k]].position[axis] < cut) count++;
+      comm.sum(&count, 1);
+      if (count < target)
+        a = cut;
+      else
+        b = cut;
+    }
+    const double cut = b;
+
+    std::vector<int> lowIndices, highIndices;
+    for (unsigned int k = 0; k < indices.size(); k++) {
+      if (particles[indices[k]].position[axis] < cut)
+        lowIndices.push_back(indices[k]);
+      else
+        highIndices.push_back(indices[k]);
+    }
+    std::vector<int>().swap(indices);
+
+    ThreeVector middleHigh = high;
+    ThreeVector middleLow = low;
+    middleHigh[axis] = cut;
+    middleLow[axis] = cut;
+
+    const int lowChild = bisect(particles, lowIndices, rankBegin, rankMiddle,
+                                low, middleHigh);
+    const int highChild = bisect(particles, highIndices, rankMiddle, rankEnd,
+                                 middleLow, high);
+
+    nodes[index].axis = axis;
+    nodes[index].cut = cut;
+    nodes[index].low = lowChild;
+    nodes[index].high = highChild;
+    nodes[index].rank = -1;
+    return index;
+  }
+
+  DomainDecomposition& DomainDecomposition::partition(
+          std::vector<Particle>& particles) {
+    std::vector<int> indices(particles.size());
+    for (unsigned int i = 0; i < particles.size(); i++) {
+      box.wrap(particles[i].position);
+      indices[i] = i;
+    }
+
+    ThreeVector low, high;
+    space(box, low, high);
+    nodes.clear();
+    bisect(particles, indices, 0, comm.size(), low, high);
+
+    return migrate(particles);
+  }
+
+  int DomainDecomposition::owner(const ThreeVector& position) const {
+    int index = 0;
+    while (nodes[index].low >= 0) {
+      const Node& node = nodes[index];
+      const double x = box.wrap(position[node.axis], node.axis);
+      index = x < node.cut ? node.low : node.high;
+    }
+    return nodes[index].rank;
+  }
+
+  DomainDecomposition& DomainDecomposition::migrate(
+          std::vector<Particle>& particles) {
+    const int me = comm.rank();
+    std::vector<std::vector<double> > sends(comm.size()), receives;
+
+    std::vector<Particle> kept;
+    kept.reserve(particles.size());
+    for (unsigned int i = 0; i < particles.size(); i++) {
+      box.wrap(particles[i].position);
+      const int o = owner(particles[i].position);
+      if (o == me)
+        kept.push_back(particles[i]);
+      else
+        pack(particles[i], sends[o]);
+    }
+
+    comm.exchange(sends, receives);
+
+    // kept particles stay in order, so nothing changed without messages
+    if (kept.size() != particles.size()) migrated = true;
+    particles.swap(kept);
+    for (unsigned int r = 0; r < receives.size(); r++) {
+      if (!receives[r].empty()) migrated = true;
+      unpack(receives[r], particles);
+    }
+    return *this;
+  }
+
+  void DomainDecomposition::exchangeHalo(const std::vector<Particle>& particles,
+                                         const double width,
+                                         std::vector<Particle>& ghosts) const {
+    std::vector<int> sent;
+    exchangeHalo(particles, width, ghosts, sent);
+  }
+
+  void DomainDecomposition::exchangeHalo(const std::vector<Particle>& particles,
+                                         const double width,
+                                         std::vector<Particle>& ghosts,
+                                         std::vector<int>& sent) const {
+    const int me = comm.rank();
+    const int ranks = comm.size();
+    std::vector<std::vector<double> > sends(ranks), receives;
+
+    sent.clear();
+    for (unsigned int i = 0; i < particles.size(); i++) {
+      const ThreeVector& r = particles[i].position;
+      for (int o = 0; o < ranks; o++) {
+        if (o == me) continue;
+
+        // distance to the domain of o, from the nearest periodic image
+        Particle image = particles[i];
+        double distance_square = 0;
+        for (int d = 0; d < 3; d++) {
+          double nearest = HUGE_VAL;
+          const int images = box.isPeriodic(d) ? 1 : 0;
+          for (int k = -images; k <= images; k++) {
+            const double x = r[d] + k*box.getLength(d);
+            const double outside = std::max(0.0, std::max(lower[o][d] - x,
+                                                          x - upper[o][d]));
+            if (outside < nearest) {
+              nearest = outside;
+              image.position[d] = x;
+            }
+          }
+          distance_square += nearest*nearest;
+        }
+        if (distance_square < width*width) {
+          pack(image, sends[o]);
+          sent.push_back(i);
+          sent.push_back(o);
+        }
+      }
+    }
+
+    comm.exchange(sends, receives);
+
+    ghosts.clear();
+    for (unsigned int r = 0; r < receives.size(); r++)
+      unpack(receives[r], ghosts);
+  }
+
+  void DomainDecomposition::exchangeSummaries(
+          const std::vector<Particle>& particles,
+          std::vector<Particle>& summaries) const {
+    const int ranks = comm.size();
+    std::vector<double> values(5*ranks, 0);
+
+    double* own = &values[5*comm.rank()];
+    for (unsigned int i = 0; i < particles.size(); i++) {
+      const Particle& p = particles[i];
+      own[0] += p.mass;
+      for (int d = 0; d < 3; d++)
+        own[1+d] += p.mass*p.position[d];
+      own[4] += p.charge;
+    }
+    comm.sum(&values[0], values.size());
+
+    summaries.resize(ranks);
+    for (int r = 0; r < ranks; r++) {
+      const double* v = &values[5*r];
+      const double m = v[0];
+      const ThreeVector centre = m != 0
+        ? ThreeVector(v[1]/m, v[2]/m, v[3]/m) : ThreeVector();
+      summaries[r] = Particle(centre, ThreeVector(), m, v[4]);
+    }
+  }
+
+  DomainDecomposition& DomainDecomposition::screenedColoumbForce(
+          std::vector<Particle>& particles, ScreenedColoumbForce& force,
+          const double dt) {
+    const VerletList& verlet = force.neighbourList();
+    for (int d = 0; d < 3; d++)
+      if (verlet.getBox().getLength(d) != box.getLength(d))
+        throw std::invalid_argument("DomainDecomposition: the force does not"
+                                    " use the box of the decomposition");
+
+    // ghosts within the Verlet range keep the halo stable between steps
+    std::vector<Particle> all;
+    std::vector<int> sent;
+    exchangeHalo(particles, verlet.getCutoff() + verlet.getSkin(), all,
+                 sent);
+    all.insert(all.begin(), particles.begin(), particles.end());
+
+    // The list refers to particles by their index in all, which changes
+    // with the particles of this rank and with the sends of any rank.
+    double changed = migrated || sent != haloSends ? 1 : 0;
+    comm.max(&changed, 1);
+    if (changed != 0) force.invalidate();
+    migrated = false;
+    haloSends.swap(sent);
+
+    force.apply(all, dt);
+
+    // forces on ghosts belong to their owners and are dropped here
+    for (unsigned int i = 0; i < particles.size(); i++)
+      particles[i].dv = all[i].dv;
+    return *this;
+  }
+
+} // namespace bps
@@ -0,0 +1,117 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_DOMAIN_H
+#define BPS_DOMAIN_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_communicator.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+
+namespace bps {
+
+  // Distributes particles over the ranks of a communicator by orthogonal
+  // recursive bisection: the rank range is split in two, space is cut
+  // along the longest extent of the particles so that both halves get
+  // particles in proportion to their ranks, and so on. Along open
+  // directions the outermost domains are unbounded, so every position has
+  // an owner; along periodic directions of the box the domains tile
+  // [0, L) and positions are wrapped into it. Each rank keeps the
+  // particles of its own domain in an ordinary vector.
+  class DomainDecomposition {
+    protected:
+      struct Node {
+        int axis;
+        double cut;
+        int low, high;  // children, or -1 for a leaf
+        int rank;       // owner of a leaf
+      };
+
+      const Communicator& comm;
+      PeriodicBox box;
+      std::vector<Node> nodes;
+      std::vector<ThreeVector> lower, upper;
+
+      // whether migrate changed the particles of this rank, and the halo
+      // sends (index, rank) of the last force, both since the last force
+      bool migrated;
+      std::vector<int> haloSends;
+
+      int bisect(const std::vector<Particle>& particles,
+                 std::vector<int>& indices, const int rankBegin,
+                 const int rankEnd, const ThreeVector& low,
+                 const ThreeVector& high);
+
+      // exchangeHalo, also returning the (index, rank) pairs sent
+      void exchangeHalo(const std::vector<Particle>& particles,
+                        const double width, std::vector<Particle>& ghosts,
+                        std::vector<int>& sent) const;
+
+    public:
+      DomainDecomposition(const Communicator& _comm,
+                          const PeriodicBox& _box = PeriodicBox());
+
+      // computes new domains from the particles of all ranks and migrates
+      // the particles to their owners
+      DomainDecomposition& partition(std::vector<Particle>& particles);
+
+      // sends particles that have left this domain (e.g. after
+      // updatePosition) to their new owners
+      DomainDecomposition& migrate(std::vector<Particle>& particles);
+
+      // copies of the particles of other ranks that are closer than width
+      // to this domain; in periodic directions the copy is the image
+      // nearest to the domain
+      void exchangeHalo(const std::vector<Particle>& particles,
+                        const double width,
+                        std::vector<Particle>& ghosts) const;
+
+      // one pseudo-particle per rank at the centre of mass of its particles,
+      // carrying their total mass and charge; enough for far field terms
+      void exchangeSummaries(const std::vector<Particle>& particles,
+                             std::vector<Particle>& summaries) const;
+
+      // ScreenedColoumbForce::apply for the particles of this rank, with
+      // ghosts of the neighbouring domains so the result equals the one of
+      // a single process. The Verlet list of the force is rebuilt whenever
+      // the particles of any rank or any halo have changed since the last
+      // call. The force has to use the box of the decomposition, otherwise
+      // std::invalid_argument is thrown.
+      DomainDecomposition& screenedColoumbForce(
+              std::vector<Particle>& particles, ScreenedColoumbForce& force,
+              const double dt);
+
+      int owner(const ThreeVector& position) const;
+
+      inline const PeriodicBox& getBox() const { return box; }
+
+      inline const ThreeVector& domainLower(int rank) const {
+        return lower[rank];
+      }
+      inline const ThreeVector& domainUpper(int rank) const {
+        return upper[rank];
+      }
+  };
+
+} // namespace bps
+
+#endif // BPS_DOMAIN_H
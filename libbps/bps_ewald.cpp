@@ -0,0 +1,326 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_ewald.h"
+#include "bps_fft.h"
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  namespace {
+
+    // the box of a ParticleMeshEwald, rejected unless the sums are defined
+    const PeriodicBox& checkedBox(const PeriodicBox& box, const double cutoff,
+                                  const double accuracy) {
+      for (int d = 0; d < 3; d++)
+        if (!box.isPeriodic(d))
+          throw std::invalid_argument(
+              "ParticleMeshEwald: the box must be periodic in all directions");
+      if (!(cutoff > 0))
+        throw std::invalid_argument(
+            "ParticleMeshEwald: the cutoff must be positive");
+      if (!(accuracy > 0 && accuracy < 1))
+        throw std::invalid_argument(
+            "ParticleMeshEwald: the accuracy must be in (0, 1)");
+
+      // the Verlet list of the real space sum uses a skin of cutoff/10
+      for (int d = 0; d < 3; d++)
+        if (1.1*cutoff > box.getLength(d)/2)
+          throw std::invalid_argument(
+              "ParticleMeshEwald: cutoff + skin exceeds half the box length");
+      return box;
+    }
+
+    int checkedOrder(const int order) {
+      if (order < 2 || order > ParticleMeshEwald::maxOrder)
+        throw std::invalid_argument(
+            "ParticleMeshEwald: the order must be in [2, maxOrder]");
+      return order;
+    }
+
+  } // namespace
+
+  const int ParticleMeshEwald::maxOrder;
+
+  ParticleMeshEwald::ParticleMeshEwald(const PeriodicBox& _box,
+                                       const double _cutoff,
+                                       const double accuracy,
+                                       const int _order)
+          : box(checkedBox(_box, _cutoff, accuracy)), cutoff(_cutoff),
+            alpha(splittingParameter(_cutoff, accuracy)),
+            order(checkedOrder(_order)),
+            verlet(_cutoff, 0.1*_cutoff, _box) {
+    // Reciprocal space terms decay like exp(-(pi m/(alpha L))^2), so the
+    // grid has to resolve modes up to m = alpha L sqrt(-ln accuracy)/pi.
+    const double modes = alpha*std::sqrt(-std::log(accuracy))/M_PI;
+    for (int d = 0; d < 3; d++) {
+      const int m = static_cast<int>(std::ceil(2*modes*box.getLength(d)));
+      K[d] = FourierTransform::nextPowerOfTwo(std::max(8, m));
+    }
+    setupInfluence();
+  }
+
+  double ParticleMeshEwald::splittingParameter(const double cutoff,
+                                               const double accuracy) {
+    double low = 0;
+    double high = 1;
+    while (erfc(high*cutoff) > accuracy)
+      high *= 2;
+    for (int i = 0; i < 100; i++) {
+      const double mid = (low + high)/2;
+      if (erfc(mid*cutoff) > accuracy)
+        low = mid;
+      else
+        high = mid;
+    }
+    return (low + high)/2;
+  }
+
+  // Cardinal B-spline weights M_p(u - g) and their derivatives for the p
+  // grid points g = first, ..., first + p - 1 (not yet wrapped).
+  void ParticleMeshEwald::splines(const double u, int& first,
+                                  double w[maxOrder],
+                                  double dw[maxOrder]) const {
+    const int p = order;
+    const double f = u - std::floor(u);
+    first = static_cast<int>(std::floor(u)) - p + 1;
+
+    // m[j] = M_k(f + j), raised from k = 1 to k = p
+    double m[maxOrder];
+    double previous[maxOrder];
+    m[0] = 1;
+    for (int k = 1; k < p; k++) {
+      if (k == p-1) {
+        for (int j = 0; j < k; j++)
+          previous[j] = m[j];
+      }
+      m[k] = (1 - f)*m[k-1]/k;
+      for (int j = k-1; j > 0; j--)
+        m[j] = ((f + j)*m[j] + (k + 1 - f - j)*m[j-1])/k;
+      m[0] = f*m[0]/k;
+    }
+
+    // M_p'(x) = M_{p-1}(x) - M_{p-1}(x - 1)
+    for (int j = 0; j < p; j++) {
+      const double a = j < p-1 ? previous[j] : 0;
+      const double b = j > 0 ? previous[j-1] : 0;
+      w[p-1-j] = m[j];
+      dw[p-1-j] = p > 1 ? a - b : 0;
+    }
+  }
+
+  void ParticleMeshEwald::setupInfluence() {
+    // |b(m)|^-2 of the B-spline interpolation per direction
+    std::vector<double> correction[3];
+    for (int d = 0; d < 3; d++) {
+      int first;
+      double w[maxOrder], dw[maxOrder];
+      splines(0, first, w, dw);
+
+      correction[d].resize(K[d]);
+      for (int m = 0; m < K[d]; m++) {
+        std::complex<double> sum = 0;
+        for (int j = 0; j < order; j++)
+          sum += w[j]*std::polar(1.0, 2*M_PI*m*(first + j)/K[d]);
+        correction[d][m] = std::norm(sum) > 1e-10 ? 1/std::norm(sum) : 0;
+      }
+    }
+
+    // The normalized inverse FFT divides by the number of grid points,
+    // which the potential must not.
+    const int size = K[0]*K[1]*K[2];
+    const double scale = size/box.volume();
+
+    influence.assign(size, 0);
+    for (int a = 0; a < K[0]; a++) {
+      const double kx = 2*M_PI*(a < K[0]/2 ? a : a - K[0])/box.getLength(0);
+      for (int b = 0; b < K[1]; b++) {
+        const double ky = 2*M_PI*(b < K[1]/2 ? b : b - K[1])/box.getLength(1);
+        for (int c = 0; c < K[2]; c++) {
+          const double kz = 2*M_PI*(c < K[2]/2 ? c : c - K[2])
+                            /box.getLength(2);
+          const double k_square = kx*kx + ky*ky + kz*kz;
+          if (k_square == 0) continue;
+
+          influence[(a*K[1] + b)*K[2] + c] =
+            4*M_PI*scale/k_square*std::exp(-k_square/(4*alpha*alpha))
+            *correction[0][a]*correction[1][b]*correction[2][c];
+        }
+      }
+    }
+  }
+
+  void ParticleMeshEwald::assign(const std::vector<Particle>& particles) {
+    const int np = particles.size();
+
+    // Slabs are at least order planes wide, so a stencil only reaches into
+    // the preceding slab and slabs of equal parity can be filled
+    // concurrently (K[0] is a power of two, hence the slab count too).
+    const int width = FourierTransform::nextPowerOfTwo(order);
+    const int slabs = std::max(1, K[0]/width);
+
+    grid.assign(K[0]*K[1]*K[2], 0);
+
+    std::vector<int> slabOf(np);
+    slabStart.assign(slabs+1, 0);
+    for (int i = 0; i < np; i++) {
+      const double u = K[0]*box.wrap(particles[i].position[0], 0)
+                       /box.getLength(0);
+      slabOf[i] = std::min(slabs-1, static_cast<int>(u)/width);
+      slabStart[slabOf[i]+1]++;
+    }
+    for (int s = 0; s < slabs; s++)
+      slabStart[s+1] += slabStart[s];
+    std::vector<int> fill(slabStart.begin(), slabStart.end()-1);
+    slabParticles.resize(np);
+    for (int i = 0; i < np; i++)
+      slabParticles[fill[slabOf[i]]++] = i;
+
+    for (int color = 0; color < 2; color++) {
+      #pragma omp parallel for schedule(dynamic)
+      for (int s = color; s < slabs; s += 2) {
+        for (int k = slabStart[s]; k < slabStart[s+1]; k++) {
+          const Particle& p = particles[slabParticles[k]];
+          if (p.charge == 0) continue;
+
+          int first[3];
+          double w[3][maxOrder], dw[3][maxOrder];
+          for (int d = 0; d < 3; d++)
+            splines(K[d]*box.wrap(p.position[d], d)/box.getLength(d),
+                    first[d], w[d], dw[d]);
+
+          for (int a = 0; a < order; a++) {
+            const int x = (first[0] + a + K[0]) % K[0];
+            for (int b = 0; b < order; b++) {
+              const int y = (first[1] + b + K[1]) % K[1];
+              const double wxy = p.charge*w[0][a]*w[1][b];
+              for (int c = 0; c < order; c++) {
+                const int z = (first[2] + c + K[2]) % K[2];
+                grid[(x*K[1] + y)*K[2] + z] += wxy*w[2][c];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void ParticleMeshEwald::solve() {
+    const int size = K[0]*K[1]*K[2];
+
+    FourierTransform::transform3d(grid, K[0], K[1], K[2]);
+    for (int i = 0; i < size; i++)
+      grid[i] *= influence[i];
+    FourierTransform::transform3d(grid, K[0], K[1], K[2], true);
+
+    potential.resize(size);
+    for (int i = 0; i < size; i++)
+      potential[i] = grid[i].real();
+  }
+
+  void ParticleMeshEwald::realSpaceForce(std::vector<Particle>& particles,
+                                         const double dt) {
+    verlet.update(particles);
+
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const double cutoff_square = cutoff*cutoff;
+    const int n = particles.size();
+
+    for (int i = 0; i < n; i++) {
+      Particle& p = particles[i];
+      if (p.charge == 0) continue;
+
+      for (int m = verlet.neighbourBegin(i); m < verlet.neighbourEnd(i); m++) {
+        Particle& q = particles[verlet.neighbour(m)];
+        if (q.charge == 0) continue;
+
+        double r[3];
+        for (int d = 0; d < 3; d++)
+          r[d] = box.minimumImage(q.position[d] - p.position[d], d);
+        const double l_square = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+        if (l_square >= cutoff_square) continue;
+
+        const double l = std::sqrt(l_square);
+        const double f = dt*k*p.charge*q.charge
+                         *(erfc(alpha*l)/l + 2*alpha/std::sqrt(M_PI)
+                           *std::exp(-alpha*alpha*l_square))/l_square;
+        for (int d = 0; d < 3; d++) {
+          if (q.mass != 0) q.dv[d] += f/q.mass*r[d];
+          if (p.mass != 0) p.dv[d] -= f/p.mass*r[d];
+        }
+      }
+    }
+  }
+
+  void ParticleMeshEwald::reciprocalForce(std::vector<Particle>& particles,
+                                          const double dt) {
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const int np = particles.size();
+
+    #pragma omp parallel for
+    for (int i = 0; i < np; i++) {
+      Particle& p = particles[i];
+      if (p.charge == 0 || p.mass == 0) continue;
+
+      int first[3];
+      double w[3][maxOrder], dw[3][maxOrder];
+      for (int d = 0; d < 3; d++)
+        splines(K[d]*box.wrap(p.position[d], d)/box.getLength(d),
+                first[d], w[d], dw[d]);
+
+      double gradient[3] = {0, 0, 0};
+      for (int a = 0; a < order; a++) {
+        const int x = (first[0] + a + K[0]) % K[0];
+        for (int b = 0; b < order; b++) {
+          const int y = (first[1] + b + K[1]) % K[1];
+          for (int c = 0; c < order; c++) {
+            const int z = (first[2] + c + K[2]) % K[2];
+            const double phi = potential[(x*K[1] + y)*K[2] + z];
+            gradient[0] += dw[0][a]*w[1][b]*w[2][c]*phi;
+            gradient[1] += w[0][a]*dw[1][b]*w[2][c]*phi;
+            gradient[2] += w[0][a]*w[1][b]*dw[2][c]*phi;
+          }
+        }
+      }
+
+      for (int d = 0; d < 3; d++)
+        p.dv[d] -= (dt/p.mass)*k*p.charge*gradient[d]*K[d]/box.getLength(d);
+    }
+  }
+
+  ParticleMeshEwald& ParticleMeshEwald::coloumbForce(
+          std::vector<Particle>& particles, const double dt) {
+    if (particles.empty()) return *this;
+
+    realSpaceForce(particles, dt);
+    assign(particles);
+    solve();
+    reciprocalForce(particles, dt);
+    return *this;
+  }
+
+} // namespace bps
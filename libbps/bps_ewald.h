@@ -0,0 +1,88 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_EWALD_H
+#define BPS_EWALD_H
+
+#include <vector>
+
+#include "bps_fft.h"
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  // Coloumb force in a fully periodic box by smooth particle-mesh Ewald
+  // summation. The interaction is split into a short-range part
+  // erfc(alpha r)/r, summed directly over the nearest images within cutoff,
+  // and a smooth long-range part that is solved on a grid with B-spline
+  // charge assignment of the given order and an FFT. The splitting
+  // parameter alpha and the grid size are chosen from the relative accuracy
+  // of the truncated real space sum.
+  class ParticleMeshEwald {
+    public:
+      static const int maxOrder = 8;
+
+    protected:
+      PeriodicBox box;
+      double cutoff;
+      double alpha;
+      int order;
+      int K[3];
+
+      VerletList verlet;
+
+      std::vector<double> influence;
+      std::vector<FourierTransform::complex> grid;
+      std::vector<double> potential;
+
+      std::vector<int> slabStart;
+      std::vector<int> slabParticles;
+
+      void splines(const double u, int& first, double w[maxOrder],
+                   double dw[maxOrder]) const;
+      void setupInfluence();
+      void assign(const std::vector<Particle>& particles);
+      void solve();
+      void realSpaceForce(std::vector<Particle>& particles, const double dt);
+      void reciprocalForce(std::vector<Particle>& particles, const double dt);
+
+    public:
+      // The box must be periodic in all directions, cutoff (plus the skin
+      // of cutoff/10 of the Verlet list) must not exceed half of the
+      // smallest box length and the order must be in [2, maxOrder],
+      // otherwise std::invalid_argument is thrown.
+      ParticleMeshEwald(const PeriodicBox& _box, const double _cutoff,
+                        const double accuracy = 1e-5, const int _order = 4);
+
+      ParticleMeshEwald& coloumbForce(std::vector<Particle>& particles,
+                                      const double dt);
+
+      // alpha with erfc(alpha*cutoff) == accuracy
+      static double splittingParameter(const double cutoff,
+                                       const double accuracy);
+
+      inline double getAlpha() const { return alpha; }
+      inline double getCutoff() const { return cutoff; }
+      inline int gridSize(int d) const { return K[d]; }
+  };
+
+} // namespace bps
+
+#endif // BPS_EWALD_H
@@ -0,0 +1,120 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "bps_fft.h"
+
+namespace bps {
+
+  namespace {
+
+    typedef FourierTransform::complex complex;
+
+    void transformContiguous(complex* a, const int n, const bool inverse,
+                             const std::vector<complex>& twiddle) {
+      // bit reversal permutation
+      for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+      }
+
+      for (int len = 2; len <= n; len <<= 1) {
+        const int half = len/2;
+        const int step = n/len;
+        for (int i = 0; i < n; i += len) {
+          for (int j = 0; j < half; j++) {
+            const complex w = inverse ? std::conj(twiddle[j*step])
+                                      : twiddle[j*step];
+            const complex u = a[i+j];
+            const complex v = a[i+j+half]*w;
+            a[i+j] = u + v;
+            a[i+j+half] = u - v;
+          }
+        }
+      }
+
+      if (inverse) {
+        for (int i = 0; i < n; i++)
+          a[i] /= n;
+      }
+    }
+
+    void twiddleFactors(const int n, std::vector<complex>& twiddle) {
+      twiddle.resize(n/2);
+      for (int j = 0; j < n/2; j++)
+        twiddle[j] = std::polar(1.0, -2*M_PI*j/n);
+    }
+
+    void transformLines(complex* data, const int n, const int stride,
+                        const int lines, const int lineStride,
+                        const int blocks, const int blockStride,
+                        const bool inverse) {
+      std::vector<complex> twiddle;
+      twiddleFactors(n, twiddle);
+
+      #pragma omp parallel
+      {
+        std::vector<complex> line(n);
+
+        #pragma omp for
+        for (int l = 0; l < lines*blocks; l++) {
+          complex* start = data + (l/lines)*blockStride
+                                + (l%lines)*lineStride;
+          for (int i = 0; i < n; i++)
+            line[i] = start[i*stride];
+          transformContiguous(&line[0], n, inverse, twiddle);
+          for (int i = 0; i < n; i++)
+            start[i*stride] = line[i];
+        }
+      }
+    }
+
+  } // namespace
+
+  bool FourierTransform::isPowerOfTwo(const int n) {
+    return n > 0 && (n & (n-1)) == 0;
+  }
+
+  int FourierTransform::nextPowerOfTwo(const int n) {
+    int p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  void FourierTransform::transform(complex* data, const int n,
+                                   const int stride, const bool inverse) {
+    transformLines(data, n, stride, 1, 0, 1, 0, inverse);
+  }
+
+  void FourierTransform::transform3d(std::vector<complex>& data,
+                                     const int n0, const int n1, const int n2,
+                                     const bool inverse) {
+    complex* a = &data[0];
+    transformLines(a, n2, 1, n1, n2, n0, n1*n2, inverse);
+    transformLines(a, n1, n2, n2, 1, n0, n1*n2, inverse);
+    transformLines(a, n0, n1*n2, n2, 1, n1, n2, inverse);
+  }
+
+} // namespace bps
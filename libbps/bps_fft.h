@@ -0,0 +1,48 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_FFT_H
+#define BPS_FFT_H
+
+#include <complex>
+#include <vector>
+
+namespace bps {
+
+  // Radix-2 fast Fourier transform. All lengths must be powers of two. The
+  // inverse transforms are normalized, i.e. inverse(forward(a)) == a.
+  class FourierTransform {
+    public:
+      typedef std::complex<double> complex;
+
+      static bool isPowerOfTwo(const int n);
+      static int nextPowerOfTwo(const int n);
+
+      // in-place transform of n values that are stride elements apart
+      static void transform(complex* data, const int n, const int stride,
+                            const bool inverse = false);
+
+      // in-place transform of an n0 x n1 x n2 array (last index fastest)
+      static void transform3d(std::vector<complex>& data, const int n0,
+                              const int n1, const int n2,
+                              const bool inverse = false);
+  };
+
+} // namespace bps
+
+#endif // BPS_FFT_H
@@ -0,0 +1,153 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_field.h"
+
+namespace bps {
+
+  UniformField::UniformField(const ThreeVector& _e, const ThreeVector& _b)
+          : e(_e), b(_b) {}
+
+  void UniformField::evaluate(const int n, const double*, const double*,
+                              const double*, const double, double* ex,
+                              double* ey, double* ez, double* bx, double* by,
+                              double* bz) const {
+    for (int i = 0; i < n; i++) {
+      ex[i] = e[0];
+      ey[i] = e[1];
+      ez[i] = e[2];
+      bx[i] = b[0];
+      by[i] = b[1];
+      bz[i] = b[2];
+    }
+  }
+
+  CallbackField::CallbackField(Function _function, void* _data)
+          : function(_function), data(_data) {}
+
+  void CallbackField::evaluate(const int n, const double* x, const double* y,
+                               const double* z, const double t, double* ex,
+                               double* ey, double* ez, double* bx, double* by,
+                               double* bz) const {
+    ThreeVector e, b;
+    for (int i = 0; i < n; i++) {
+      function(ThreeVector(x[i], y[i], z[i]), t, e, b, data);
+      ex[i] = e[0];
+      ey[i] = e[1];
+      ez[i] = e[2];
+      bx[i] = b[0];
+      by[i] = b[1];
+      bz[i] = b[2];
+    }
+  }
+
+  GriddedField::GriddedField(const ThreeVector& _origin, const double _spacing,
+                             const int nx, const int ny, const int nz)
+          : origin(_origin), spacing(_spacing) {
+    if (!(spacing > 0))
+      throw std::invalid_argument("GriddedField: the spacing must be positive");
+    if (nx < 2 || ny < 2 || nz < 2)
+      throw std::invalid_argument(
+          "GriddedField: the grid needs at least two points per direction");
+    dim[0] = nx;
+    dim[1] = ny;
+    dim[2] = nz;
+    values.assign(6*nx*ny*nz, 0);
+  }
+
+  GriddedField& GriddedField::set(const int i, const int j, const int k,
+                                  const ThreeVector& e, const ThreeVector& b) {
+    if (i < 0 || i >= dim[0] || j < 0 || j >= dim[1] || k < 0 || k >= dim[2])
+      throw std::out_of_range("GriddedField: point outside of the grid");
+    double* v = &values[6*((i*dim[1] + j)*dim[2] + k)];
+    for (int d = 0; d < 3; d++) {
+      v[d] = e[d];
+      v[3+d] = b[d];
+    }
+    return *this;
+  }
+
+  GriddedField& GriddedField::sample(const ElectromagneticField& field,
+                                     const double t) {
+    // one row along z at a time
+    const int nz = dim[2];
+    std::vector<double> x(nz), y(nz), z(nz), f(6*nz);
+    for (int i = 0; i < dim[0]; i++) {
+      for (int j = 0; j < dim[1]; j++) {
+        for (int k = 0; k < nz; k++) {
+          x[k] = origin[0] + i*spacing;
+          y[k] = origin[1] + j*spacing;
+          z[k] = origin[2] + k*spacing;
+        }
+        field.evaluate(nz, &x[0], &y[0], &z[0], t, &f[0], &f[nz],
+                       &f[2*nz], &f[3*nz], &f[4*nz], &f[5*nz]);
+        for (int k = 0; k < nz; k++)
+          for (int c = 0; c < 6; c++)
+            values[6*((i*dim[1] + j)*nz + k) + c] = f[c*nz + k];
+      }
+    }
+    return *this;
+  }
+
+  void GriddedField::evaluate(const int n, const double* x, const double* y,
+                              const double* z, const double, double* ex,
+                              double* ey, double* ez, double* bx, double* by,
+                              double* bz) const {
+    double* out[6] = {ex, ey, ez, bx, by, bz};
+    const double* r[3] = {x, y, z};
+
+    for (int i = 0; i < n; i++) {
+      int cell[3];
+      double w[3];
+      bool inside = true;
+      for (int d = 0; d < 3; d++) {
+        const double u = (r[d][i] - origin[d])/spacing;
+        // far away and NaN positions have to be rejected before the cast
+        inside = u >= 0 && u <= dim[d]-1 && dim[d] > 1;
+        if (!inside) break;
+        // the last plane belongs to the last cell
+        cell[d] = std::min(static_cast<int>(std::floor(u)), dim[d]-2);
+        w[d] = u - cell[d];
+      }
+
+      double f[6] = {0, 0, 0, 0, 0, 0};
+      if (inside) {
+        for (int a = 0; a < 2; a++)
+          for (int b = 0; b < 2; b++)
+            for (int c = 0; c < 2; c++) {
+              const double weight = (a ? w[0] : 1 - w[0])
+                                    *(b ? w[1] : 1 - w[1])
+                                    *(c ? w[2] : 1 - w[2]);
+              const double* v = &values[6*(((cell[0]+a)*dim[1] + cell[1]+b)
+                                           *dim[2] + cell[2]+c)];
+              for (int k = 0; k < 6; k++)
+                f[k] += weight*v[k];
+            }
+      }
+      for (int k = 0; k < 6; k++)
+        out[k][i] = f[k];
+    }
+  }
+
+} // namespace bps
@@ -0,0 +1,102 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_FIELD_H
+#define BPS_FIELD_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+
+namespace bps {
+
+  // External electric (V/m) and magnetic (T) field. It is evaluated for
+  // batches of points so that implementations can vectorize.
+  class ElectromagneticField {
+    public:
+      virtual ~ElectromagneticField() {}
+
+      virtual void evaluate(const int n, const double* x, const double* y,
+                            const double* z, const double t, double* ex,
+                            double* ey, double* ez, double* bx, double* by,
+                            double* bz) const = 0;
+  };
+
+  // Fields that do not depend on position or time.
+  class UniformField : public ElectromagneticField {
+    protected:
+      ThreeVector e, b;
+
+    public:
+      UniformField(const ThreeVector& _e, const ThreeVector& _b);
+
+      void evaluate(const int n, const double* x, const double* y,
+                    const double* z, const double t, double* ex, double* ey,
+                    double* ez, double* bx, double* by, double* bz) const;
+  };
+
+  // Fields given by a user function, called once per point. The function
+  // may be called from several threads at once.
+  class CallbackField : public ElectromagneticField {
+    public:
+      typedef void (*Function)(const ThreeVector& r, const double t,
+                               ThreeVector& e, ThreeVector& b, void* data);
+
+    protected:
+      Function function;
+      void* data;
+
+    public:
+      CallbackField(Function _function, void* _data = 0);
+
+      void evaluate(const int n, const double* x, const double* y,
+                    const double* z, const double t, double* ex, double* ey,
+                    double* ez, double* bx, double* by, double* bz) const;
+  };
+
+  // Static fields sampled on a regular grid of nx x ny x nz points starting
+  // at origin, trilinearly interpolated in between. Both fields vanish
+  // outside of the grid. The spacing has to be positive and the grid at
+  // least 2 x 2 x 2 points, otherwise std::invalid_argument is thrown.
+  class GriddedField : public ElectromagneticField {
+    protected:
+      ThreeVector origin;
+      double spacing;
+      int dim[3];
+      std::vector<double> values;  // six components per grid point
+
+    public:
+      GriddedField(const ThreeVector& _origin, const double _spacing,
+                   const int nx, const int ny, const int nz);
+
+      // throws std::out_of_range for points outside of the grid
+      GriddedField& set(const int i, const int j, const int k,
+                        const ThreeVector& e, const ThreeVector& b);
+
+      // samples another field at the grid points (at time t)
+      GriddedField& sample(const ElectromagneticField& field,
+                           const double t = 0);
+
+      void evaluate(const int n, const double* x, const double* y,
+                    const double* z, const double t, double* ex, double* ey,
+                    double* ez, double* bx, double* by, double* bz) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_FIELD_H
@@ -0,0 +1,429 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_kd-tree.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  namespace {
+
+    // subtrees with more points than this are built in their own task
+    const int taskGrain = 1 << 15;
+
+    // centers per task of the batched queries
+    const int queryBlock = 64;
+
+    struct Frame {
+      int node, begin, end, level;
+    };
+
+    // points are partitioned as whole records during the build, which
+    // keeps the median searches cache friendly
+    struct Point {
+      double r[3];
+      int index;
+    };
+
+    class CoordinateLess {
+      protected:
+        int axis;
+
+      public:
+        CoordinateLess(const int _axis) : axis(_axis) {}
+        bool operator()(const Point& a, const Point& b) const {
+          return a.r[axis] < b.r[axis];
+        }
+    };
+
+    void buildNode(std::vector<Point>& points, std::vector<double>& boxes,
+                   const int depth, const int node, const int begin,
+                   const int end, const int level) {
+      double* box = &boxes[6*node];
+      for (int d = 0; d < 3; d++) {
+        box[d] = std::numeric_limits<double>::infinity();
+        box[3+d] = -std::numeric_limits<double>::infinity();
+      }
+      for (int i = begin; i < end; i++) {
+        for (int d = 0; d < 3; d++) {
+          box[d] = std::min(box[d], points[i].r[d]);
+          box[3+d] = std::max(box[3+d], points[i].r[d]);
+        }
+      }
+      if (level == depth) return;
+
+      // split at the median along the longest extent
+      int axis = 0;
+      for (int d = 1; d < 3; d++)
+        if (box[3+d] - box[d] > box[3+axis] - box[axis]) axis = d;
+
+      const int mid = begin + (end - begin)/2;
+      std::nth_element(points.begin() + begin, points.begin() + mid,
+                       points.begin() + end, CoordinateLess(axis));
+
+      if (end - begin > taskGrain) {
+        #pragma omp task shared(points, boxes)
+        buildNode(points, boxes, depth, 2*node + 1, begin, mid, level + 1);
+        #pragma omp task shared(points, boxes)
+        buildNode(points, boxes, depth, 2*node + 2, mid, end, level + 1);
+      } else {
+        buildNode(points, boxes, depth, 2*node + 1, begin, mid, level + 1);
+        buildNode(points, boxes, depth, 2*node + 2, mid, end, level + 1);
+      }
+    }
+
+  } // namespace
+
+  KdTree::KdTree(const int _leafSize)
+          : leafSize(std::max(1, _leafSize)), depth(0) {}
+
+  KdTree& KdTree::build(const std::vector<ThreeVector>& positions) {
+    const int n = positions.size();
+    px.resize(n);
+    py.resize(n);
+    pz.resize(n);
+    for (int i = 0; i < n; i++) {
+      px[i] = positions[i][0];
+      py[i] = positions[i][1];
+      pz[i] = positions[i][2];
+    }
+    return buildTree();
+  }
+
+  KdTree& KdTree::build(const std::vector<Particle>& particles) {
+    const int n = particles.size();
+    px.resize(n);
+    py.resize(n);
+    pz.resize(n);
+    for (int i = 0; i < n; i++) {
+      px[i] = particles[i].position[0];
+      py[i] = particles[i].position[1];
+      pz[i] = particles[i].position[2];
+    }
+    return buildTree();
+  }
+
+  KdTree& KdTree::build(const ParticleArray& particles) {
+    px = particles.x;
+    py = particles.y;
+    pz = particles.z;
+    return buildTree();
+  }
+
+  KdTree& KdTree::buildTree() {
+    const int n = px.size();
+    depth = 0;
+    while ((n + (1 << depth) - 1) >> depth > leafSize)
+      depth++;
+    boxes.resize(6*((2 << depth) - 1));
+
+    std::vector<Point> points(n);
+    for (int i = 0; i < n; i++) {
+      points[i].r[0] = px[i];
+      points[i].r[1] = py[i];
+      points[i].r[2] = pz[i];
+      points[i].index = i;
+    }
+
+    #pragma omp parallel
+    {
+      #pragma omp single
+      buildNode(points, boxes, depth, 0, 0, n, 0);
+    }
+
+    order.resize(n);
+    for (int i = 0; i < n; i++) {
+      px[i] = points[i].r[0];
+      py[i] = points[i].r[1];
+      pz[i] = points[i].r[2];
+      order[i] = points[i].index;
+    }
+    return *this;
+  }
+
+  KdTree& KdTree::refit(const std::vector<ThreeVector>& positions) {
+    const int n = order.size();
+    if (static_cast<int>(positions.size()) != n) return build(positions);
+
+    for (int i = 0; i < n; i++) {
+      const ThreeVector& r = positions[order[i]];
+      px[i] = r[0];
+      py[i] = r[1];
+      pz[i] = r[2];
+    }
+
+    #pragma omp parallel
+    {
+      #pragma omp single
+      refitNode(0, 0, n, 0);
+    }
+    return *this;
+  }
+
+  KdTree& KdTree::refit(const std::vector<Particle>& particles) {
+    const int n = order.size();
+    if (static_cast<int>(particles.size()) != n) return build(particles);
+
+    for (int i = 0; i < n; i++) {
+      const ThreeVector& r = particles[order[i]].position;
+      px[i] = r[0];
+      py[i] = r[1];
+      pz[i] = r[2];
+    }
+
+    #pragma omp parallel
+    {
+      #pragma omp single
+      refitNode(0, 0, n, 0);
+    }
+    return *this;
+  }
+
+  KdTree& KdTree::refit(const ParticleArray& particles) {
+    const int n = order.size();
+    if (particles.size() != n) return build(particles);
+
+    for (int i = 0; i < n; i++) {
+      px[i] = particles.x[order[i]];
+      py[i] = particles.y[order[i]];
+      pz[i] = particles.z[order[i]];
+    }
+
+    #pragma omp parallel
+    {
+      #pragma omp single
+      refitNode(0, 0, n, 0);
+    }
+    return *this;
+  }
+
+  void KdTree::refitNode(const int node, const int begin, const int end,
+                         const int level) {
+    if (level == depth) {
+      pointBox(node, begin, end);
+      return;
+    }
+
+    const int mid = begin + (end - begin)/2;
+    if (end - begin > taskGrain) {
+      #pragma omp task
+      refitNode(2*node + 1, begin, mid, level + 1);
+      #pragma omp task
+      refitNode(2*node + 2, mid, end, level + 1);
+      #pragma omp taskwait
+    } else {
+      refitNode(2*node + 1, begin, mid, level + 1);
+      refitNode(2*node + 2, mid, end, level + 1);
+    }
+
+    double* box = &boxes[6*node];
+    const double* low = &boxes[6*(2*node + 1)];
+    const double* high = &boxes[6*(2*node + 2)];
+    for (int d = 0; d < 3; d++) {
+      box[d] = std::min(low[d], high[d]);
+      box[3+d] = std::max(low[3+d], high[3+d]);
+    }
+  }
+
+  void KdTree::pointBox(const int node, const int begin, const int end) {
+    double* box = &boxes[6*node];
+    for (int d = 0; d < 3; d++) {
+      box[d] = std::numeric_limits<double>::infinity();
+      box[3+d] = -std::numeric_limits<double>::infinity();
+    }
+    for (int i = begin; i < end; i++) {
+      box[0] = std::min(box[0], px[i]);
+      box[1] = std::min(box[1], py[i]);
+      box[2] = std::min(box[2], pz[i]);
+      box[3] = std::max(box[3], px[i]);
+      box[4] = std::max(box[4], py[i]);
+      box[5] = std::max(box[5], pz[i]);
+    }
+  }
+
+  double KdTree::boxDistanceSquare(const int node, const double x,
+                                   const double y, const double z) const {
+    const double* box = &boxes[6*node];
+    const double dx = std::max(0.0, std::max(box[0] - x, x - box[3]));
+    const double dy = std::max(0.0, std::max(box[1] - y, y - box[4]));
+    const double dz = std::max(0.0, std::max(box[2] - z, z - box[5]));
+    return dx*dx + dy*dy + dz*dz;
+  }
+
+  void KdTree::radius(const ThreeVector& center, const double r,
+                      std::vector<int>& result) const {
+    result.clear();
+    if (order.empty()) return;
+
+    const double x = center[0];
+    const double y = center[1];
+    const double z = center[2];
+    const double r_square = r*r;
+
+    Frame stack[64];
+    int top = 0;
+    const Frame root = {0, 0, static_cast<int>(order.size()), 0};
+    stack[top++] = root;
+
+    while (top > 0) {
+      const Frame f = stack[--top];
+      if (boxDistanceSquare(f.node, x, y, z) > r_square) continue;
+
+      // nodes entirely inside the sphere need no distance tests
+      const double* box = &boxes[6*f.node];
+      const double fx = std::max(x - box[0], box[3] - x);
+      const double fy = std::max(y - box[1], box[4] - y);
+      const double fz = std::max(z - box[2], box[5] - z);
+      if (fx*fx + fy*fy + fz*fz <= r_square) {
+        result.insert(result.end(), order.begin() + f.begin,
+                      order.begin() + f.end);
+        continue;
+      }
+
+      if (f.level == depth) {
+        for (int i = f.begin; i < f.end; i++) {
+          const double dx = px[i] - x;
+          const double dy = py[i] - y;
+          const double dz = pz[i] - z;
+          if (dx*dx + dy*dy + dz*dz <= r_square)
+            result.push_back(order[i]);
+        }
+        continue;
+      }
+
+      const int mid = f.begin + (f.end - f.begin)/2;
+      const Frame low = {2*f.node + 1, f.begin, mid, f.level + 1};
+      const Frame high = {2*f.node + 2, mid, f.end, f.level + 1};
+      stack[top++] = low;
+      stack[top++] = high;
+    }
+  }
+
+  void KdTree::nearest(const ThreeVector& center, const int k,
+                       std::vector<int>& result,
+                       std::vector<double>& distances) const {
+    result.clear();
+    distances.clear();
+    if (order.empty() || k <= 0) return;
+
+    const double x = center[0];
+    const double y = center[1];
+    const double z = center[2];
+
+    // max-heap of the best candidates so far (squared distance, position)
+    std::vector<std::pair<double, int> > heap;
+    heap.reserve(k);
+
+    Frame stack[64];
+    int top = 0;
+    const Frame root = {0, 0, static_cast<int>(order.size()), 0};
+    stack[top++] = root;
+
+    while (top > 0) {
+      const Frame f = stack[--top];
+      if (static_cast<int>(heap.size()) == k &&
+          boxDistanceSquare(f.node, x, y, z) >= heap.front().first)
+        continue;
+
+      if (f.level == depth) {
+        for (int i = f.begin; i < f.end; i++) {
+          const double dx = px[i] - x;
+          const double dy = py[i] - y;
+          const double dz = pz[i] - z;
+          const double d_square = dx*dx + dy*dy + dz*dz;
+          if (static_cast<int>(heap.size()) < k) {
+            heap.push_back(std::make_pair(d_square, i));
+            std::push_heap(heap.begin(), heap.end());
+          } else if (d_square < heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = std::make_pair(d_square, i);
+            std::push_heap(heap.begin(), heap.end());
+          }
+        }
+        continue;
+      }
+
+      // the nearer child goes on top of the stack
+      const int mid = f.begin + (f.end - f.begin)/2;
+      Frame low = {2*f.node + 1, f.begin, mid, f.level + 1};
+      Frame high = {2*f.node + 2, mid, f.end, f.level + 1};
+      if (boxDistanceSquare(low.node, x, y, z) <
+          boxDistanceSquare(high.node, x, y, z))
+        std::swap(low, high);
+      stack[top++] = low;
+      stack[top++] = high;
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    result.resize(heap.size());
+    distances.resize(heap.size());
+    for (unsigned int i = 0; i < heap.size(); i++) {
+      result[i] = order[heap[i].second];
+      distances[i] = std::sqrt(heap[i].first);
+    }
+  }
+
+  void KdTree::radius(const std::vector<ThreeVector>& centers, const double r,
+                      std::vector<int>& offsets,
+                      std::vector<int>& result) const {
+    const int m = centers.size();
+    std::vector<std::vector<int> > found(m);
+
+    #pragma omp parallel for schedule(dynamic, queryBlock)
+    for (int i = 0; i < m; i++)
+      radius(centers[i], r, found[i]);
+
+    offsets.resize(m + 1);
+    offsets[0] = 0;
+    for (int i = 0; i < m; i++)
+      offsets[i+1] = offsets[i] + found[i].size();
+
+    result.resize(offsets[m]);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < m; i++)
+      std::copy(found[i].begin(), found[i].end(), result.begin() + offsets[i]);
+  }
+
+  void KdTree::nearest(const std::vector<ThreeVector>& centers, const int k,
+                       std::vector<int>& result) const {
+    const int m = centers.size();
+    result.assign(static_cast<long>(m)*k, -1);
+
+    #pragma omp parallel
+    {
+      std::vector<int> found;
+      std::vector<double> distances;
+
+      #pragma omp for schedule(dynamic, queryBlock)
+      for (int i = 0; i < m; i++) {
+        nearest(centers[i], k, found, distances);
+        std::copy(found.begin(), found.end(),
+                  result.begin() + static_cast<long>(k)*i);
+      }
+    }
+  }
+
+} // namespace bps
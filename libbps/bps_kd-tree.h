@@ -0,0 +1,96 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_KD_TREE_H
+#define BPS_KD_TREE_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+
+namespace bps {
+
+  // Balanced KD-tree over a fixed set of points (open boundaries). The
+  // points are stored in tree order, so every node covers a contiguous
+  // range of them; the range is split in half at each level, which makes
+  // the tree shape a function of the number of points alone. Nodes are
+  // numbered implicitly (children of i are 2i+1 and 2i+2) and store only
+  // their bounding boxes. Results are the indices of the points as they
+  // were passed to build.
+  class KdTree {
+    protected:
+      int leafSize;
+      int depth;
+
+      // positions in tree order and their original indices
+      std::vector<double> px, py, pz;
+      std::vector<int> order;
+
+      // bounding box of node i at 6i (lower x, y, z, upper x, y, z)
+      std::vector<double> boxes;
+
+      KdTree& buildTree();
+      void refitNode(const int node, const int begin, const int end,
+                     const int level);
+      void pointBox(const int node, const int begin, const int end);
+
+      double boxDistanceSquare(const int node, const double x,
+                               const double y, const double z) const;
+
+    public:
+      KdTree(const int _leafSize = 8);
+
+      KdTree& build(const std::vector<ThreeVector>& positions);
+      KdTree& build(const std::vector<Particle>& particles);
+      KdTree& build(const ParticleArray& particles);
+
+      // Updates the bounding boxes for moved points, keeping the order.
+      // Queries stay exact, but get slower as the points stray from their
+      // nodes; rebuild after large moves.
+      KdTree& refit(const std::vector<ThreeVector>& positions);
+      KdTree& refit(const std::vector<Particle>& particles);
+      KdTree& refit(const ParticleArray& particles);
+
+      inline int size() const { return order.size(); }
+      inline int getLeafSize() const { return leafSize; }
+
+      // points within distance r of center
+      void radius(const ThreeVector& center, const double r,
+                  std::vector<int>& result) const;
+
+      // the k points nearest to center, nearest first (fewer if the tree
+      // is smaller); a point at the center itself is included
+      void nearest(const ThreeVector& center, const int k,
+                   std::vector<int>& result,
+                   std::vector<double>& distances) const;
+
+      // Batched versions for many centers, run in parallel. The points
+      // near centers[i] are result[offsets[i]] to result[offsets[i+1]-1];
+      // the k nearest ones of centers[i] are result[k*i] to
+      // result[k*i+k-1], padded with -1.
+      void radius(const std::vector<ThreeVector>& centers, const double r,
+                  std::vector<int>& offsets, std::vector<int>& result) const;
+      void nearest(const std::vector<ThreeVector>& centers, const int k,
+                   std::vector<int>& result) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_KD_TREE_H
@@ -0,0 +1,27 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Kernels built with the compiler's default flags, i.e. SSE2 on x86-64.
+#ifdef __SSE2__
+#define BPS_KERNELS_LEVEL Kernels::SSE2
+#else
+#define BPS_KERNELS_LEVEL Kernels::Generic
+#endif
+#define BPS_KERNELS_NAMESPACE baseline
+
+#include "bps_kernels-impl.h"
@@ -0,0 +1,280 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Kernel bodies shared by all instruction set variants. This file is not
+// a regular header: each bps_kernels-<level>.cpp defines
+// BPS_KERNELS_NAMESPACE and BPS_KERNELS_LEVEL and includes it once, and
+// is compiled with the matching -m flags.
+
+#include <cmath>
+
+#include "bps_constants.h"
+#include "bps_kernels.h"
+
+namespace bps {
+
+  namespace BPS_KERNELS_NAMESPACE {
+
+    void axpy(const int n, const double a, const double* x, double* y) {
+      #pragma omp simd
+      for (int i = 0; i < n; i++)
+        y[i] += a*x[i];
+    }
+
+    void scale(const int n, const double a, double* x) {
+      #pragma omp simd
+      for (int i = 0; i < n; i++)
+        x[i] *= a;
+    }
+
+    void pairField(const int n, const double* x, const double* y,
+                   const double* z, const double* s, const int begin,
+                   const int end, double* fx, double* fy, double* fz) {
+      for (int i = begin; i < end; i++) {
+        const double xi = x[i];
+        const double yi = y[i];
+        const double zi = z[i];
+        double ax = 0, ay = 0, az = 0;
+
+        #pragma omp simd reduction(+:ax,ay,az)
+        for (int j = 0; j < n; j++) {
+          const double dx = xi - x[j];
+          const double dy = yi - y[j];
+          const double dz = zi - z[j];
+          const double r_square = dx*dx + dy*dy + dz*dz;
+          const double r = std::sqrt(r_square);
+          const double w = r_square > 0 ? s[j]/(r_square*r) : 0;
+          ax += w*dx;
+          ay += w*dy;
+          az += w*dz;
+        }
+
+        fx[i-begin] += ax;
+        fy[i-begin] += ay;
+        fz[i-begin] += az;
+      }
+    }
+
+    void addVelocities(const int n, double* vx, double* vy, double* vz,
+                       const double* dvx, const double* dvy,
+                       const double* dvz) {
+      const double c_square = BPS_CONST_SPEED_OF_LIGHT
+                              *BPS_CONST_SPEED_OF_LIGHT;
+
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const double u_square = dvx[i]*dvx[i] + dvy[i]*dvy[i]
+                                + dvz[i]*dvz[i];
+        // A zero dv gives n = 0 and gamma = 1, i.e. v stays unchanged. The
+        // offset keeps the division unconditional, so the loop vectorizes.
+        const double inverse = 1/(std::sqrt(u_square)
+                                  + (u_square > 0 ? 0.0 : 1.0));
+        const double nx = dvx[i]*inverse;
+        const double ny = dvy[i]*inverse;
+        const double nz = dvz[i]*inverse;
+
+        const double parallel = vx[i]*nx + vy[i]*ny + vz[i]*nz;
+        const double px = parallel*nx;
+        const double py = parallel*ny;
+        const double pz = parallel*nz;
+
+        const double gamma = std::sqrt(1 - u_square/c_square);
+        const double denominator = 1 + (vx[i]*dvx[i] + vy[i]*dvy[i]
+                                        + vz[i]*dvz[i])/c_square;
+
+        vx[i] = (px + dvx[i] + gamma*(vx[i] - px))/denominator;
+        vy[i] = (py + dvy[i] + gamma*(vy[i] - py))/denominator;
+        vz[i] = (pz + dvz[i] + gamma*(vz[i] - pz))/denominator;
+      }
+    }
+
+    void rotate(const int n, const double m[9], double* x, double* y,
+                double* z) {
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const double a = x[i];
+        const double b = y[i];
+        const double c = z[i];
+        x[i] = m[0]*a + m[1]*b + m[2]*c;
+        y[i] = m[3]*a + m[4]*b + m[5]*c;
+        z[i] = m[6]*a + m[7]*b + m[8]*c;
+      }
+    }
+
+    void transform4(const int n, const double m[16], double* a0, double* a1,
+                    double* a2, double* a3) {
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const double b0 = a0[i];
+        const double b1 = a1[i];
+        const double b2 = a2[i];
+        const double b3 = a3[i];
+        a0[i] = m[0]*b0  + m[1]*b1  + m[2]*b2  + m[3]*b3;
+        a1[i] = m[4]*b0  + m[5]*b1  + m[6]*b2  + m[7]*b3;
+        a2[i] = m[8]*b0  + m[9]*b1  + m[10]*b2 + m[11]*b3;
+        a3[i] = m[12]*b0 + m[13]*b1 + m[14]*b2 + m[15]*b3;
+      }
+    }
+
+    void boostVelocities(const int n, const double m[16], double* vx,
+                         double* vy, double* vz) {
+      const double c = BPS_CONST_SPEED_OF_LIGHT;
+
+      // The four-velocity gamma (c, v) is boosted; gamma cancels in the
+      // ratio of its spatial and time components.
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const double b1 = vx[i];
+        const double b2 = vy[i];
+        const double b3 = vz[i];
+        const double u0 = m[0]*c  + m[1]*b1  + m[2]*b2  + m[3]*b3;
+        const double u1 = m[4]*c  + m[5]*b1  + m[6]*b2  + m[7]*b3;
+        const double u2 = m[8]*c  + m[9]*b1  + m[10]*b2 + m[11]*b3;
+        const double u3 = m[12]*c + m[13]*b1 + m[14]*b2 + m[15]*b3;
+        vx[i] = c*u1/u0;
+        vy[i] = c*u2/u0;
+        vz[i] = c*u3/u0;
+      }
+    }
+
+    void borisPush(const int n, const double dt, const double* charge,
+                   const double* mass, const double* ex, const double* ey,
+                   const double* ez, const double* bx, const double* by,
+                   const double* bz, double* x, double* y, double* z,
+                   double* ux_, double* uy_, double* uz_, double* vx,
+                   double* vy, double* vz) {
+      const double c = BPS_CONST_SPEED_OF_LIGHT;
+      const double inverse_c_square = 1/(c*c);
+
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const double has_mass = mass[i] > 0 ? 1.0 : 0.0;
+        const double h = has_mass*0.5*dt*charge[i]
+                         /(mass[i] + (1 - has_mass));
+
+        // first half of the electric kick
+        const double ux = ux_[i] + h*ex[i];
+        const double uy = uy_[i] + h*ey[i];
+        const double uz = uz_[i] + h*ez[i];
+
+        // magnetic rotation
+        const double gamma_minus = std::sqrt(1 + (ux*ux + uy*uy + uz*uz)
+                                                 *inverse_c_square);
+        const double tx = h*bx[i]/gamma_minus;
+        const double ty = h*by[i]/gamma_minus;
+        const double tz = h*bz[i]/gamma_minus;
+        const double f = 2/(1 + tx*tx + ty*ty + tz*tz);
+
+        const double wx = ux + (uy*tz - uz*ty);
+        const double wy = uy + (uz*tx - ux*tz);
+        const double wz = uz + (ux*ty - uy*tx);
+
+        // second half of the electric kick
+        const double px = ux + f*(wy*tz - wz*ty) + h*ex[i];
+        const double py = uy + f*(wz*tx - wx*tz) + h*ey[i];
+        const double pz = uz + f*(wx*ty - wy*tx) + h*ez[i];
+
+        const double gamma_plus = std::sqrt(1 + (px*px + py*py + pz*pz)
+                                                *inverse_c_square);
+        ux_[i] = px;
+        uy_[i] = py;
+        uz_[i] = pz;
+        vx[i] = px/gamma_plus;
+        vy[i] = py/gamma_plus;
+        vz[i] = pz/gamma_plus;
+
+        x[i] += vx[i]*dt;
+        y[i] += vy[i]*dt;
+        z[i] += vz[i]*dt;
+      }
+    }
+
+    // Rotation about the body axis k by the angle 2 atan(h L_k/(2 I_k))
+    // (h L_k/I_k to third order) in the Cayley form, which is exactly
+    // orthogonal and needs no trigonometric functions. The body-frame
+    // angular momentum turns by the opposite angle. Zero moments skip
+    // the rotation.
+    #define BPS_ROTATE_BODY_AXIS(k, a, b, qa, qb, qc)                       \
+      {                                                                     \
+        const double has = i##k[i] > 0 ? 1.0 : 0.0;                         \
+        const double tau = has*0.5*h*l##k/(i##k[i] + (1 - has));            \
+        const double norm = 1/(1 + tau*tau);                                \
+        const double c = (1 - tau*tau)*norm;                                \
+        const double s = 2*tau*norm;                                        \
+        const double la = c*l##a + s*l##b;                                  \
+        l##b = c*l##b - s*l##a;                                             \
+        l##a = la;                                                          \
+        const double w = std::sqrt(norm);                                   \
+        const double v = tau*w;                                             \
+        const double r0 = w*p0 - v*qa;                                      \
+        const double ra = w*qa + v*p0;                                      \
+        const double rb = w*qb + v*qc;                                      \
+        const double rc = w*qc - v*qb;                                      \
+        p0 = r0;                                                            \
+        qa = ra;                                                            \
+        qb = rb;                                                            \
+        qc = rc;                                                            \
+      }
+
+    void rotateBodies(const int n, const double dt, const double* ix,
+                      const double* iy, const double* iz, double* q0,
+                      double* q1, double* q2, double* q3, double* lx_,
+                      double* ly_, double* lz_) {
+      #pragma omp simd
+      for (int i = 0; i < n; i++) {
+        double p0 = q0[i], px = q1[i], py = q2[i], pz = q3[i];
+        double lx = lx_[i], ly = ly_[i], lz = lz_[i];
+
+        // symmetric splitting x(dt/2) y(dt/2) z(dt) y(dt/2) x(dt/2)
+        double h = 0.5*dt;
+        BPS_ROTATE_BODY_AXIS(x, y, z, px, py, pz)
+        BPS_ROTATE_BODY_AXIS(y, z, x, py, pz, px)
+        h = dt;
+        BPS_ROTATE_BODY_AXIS(z, x, y, pz, px, py)
+        h = 0.5*dt;
+        BPS_ROTATE_BODY_AXIS(y, z, x, py, pz, px)
+        BPS_ROTATE_BODY_AXIS(x, y, z, px, py, pz)
+
+        q0[i] = p0;
+        q1[i] = px;
+        q2[i] = py;
+        q3[i] = pz;
+        lx_[i] = lx;
+        ly_[i] = ly;
+        lz_[i] = lz;
+      }
+    }
+
+    #undef BPS_ROTATE_BODY_AXIS
+
+    extern const Kernels::Table table = {
+      BPS_KERNELS_LEVEL,
+      axpy,
+      scale,
+      pairField,
+      addVelocities,
+      rotate,
+      transform4,
+      boostVelocities,
+      borisPush,
+      rotateBodies
+    };
+
+  } // namespace BPS_KERNELS_NAMESPACE
+
+} // namespace bps
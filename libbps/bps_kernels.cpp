@@ -0,0 +1,146 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+
+#include "bps_kernels.h"
+
+namespace bps {
+
+  namespace generic { extern const Kernels::Table table; }
+  namespace baseline { extern const Kernels::Table table; }
+#ifdef BPS_HAVE_AVX2
+  namespace avx2 { extern const Kernels::Table table; }
+#endif
+#ifdef BPS_HAVE_AVX512
+  namespace avx512 { extern const Kernels::Table table; }
+#endif
+
+  namespace {
+
+    // Written by select() and read by table() from any thread, hence the
+    // atomic accesses. The tables themselves are constant.
+    const Kernels::Table* active = 0;
+
+    inline const Kernels::Table* loadActive() {
+#ifdef __GNUC__
+      return __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+#else
+      return active;
+#endif
+    }
+
+    inline void storeActive(const Kernels::Table* table) {
+#ifdef __GNUC__
+      __atomic_store_n(&active, table, __ATOMIC_RELEASE);
+#else
+      active = table;
+#endif
+    }
+
+    // best compiled table that does not exceed level
+    const Kernels::Table* tableFor(const Kernels::Level level) {
+#ifdef BPS_HAVE_AVX512
+      if (level >= Kernels::AVX512) return &avx512::table;
+#endif
+#ifdef BPS_HAVE_AVX2
+      if (level >= Kernels::AVX2) return &avx2::table;
+#endif
+      if (level >= Kernels::SSE2) return &baseline::table;
+      return &generic::table;
+    }
+
+    const Kernels::Table* initialTable() {
+      Kernels::Level level = Kernels::supportedLevel();
+
+      const char* forced = std::getenv("BPS_SIMD_LEVEL");
+      if (forced != 0) {
+        for (int l = Kernels::Generic; l <= Kernels::AVX512; l++) {
+          const Kernels::Level candidate = static_cast<Kernels::Level>(l);
+          if (std::strcmp(forced, Kernels::levelName(candidate)) == 0
+              && candidate < level)
+            level = candidate;
+        }
+      }
+      return tableFor(level);
+    }
+
+    // the initial table, unless another thread or select() was first
+    const Kernels::Table* initialize() {
+      const Kernels::Table* initial = initialTable();
+#ifdef __GNUC__
+      const Kernels::Table* expected = 0;
+      if (!__atomic_compare_exchange_n(&active, &expected, initial, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return expected;
+      return initial;
+#else
+      if (active == 0) active = initial;
+      return active;
+#endif
+    }
+
+    // Select the table while the library is loaded, so the choice is made
+    // once and before any kernel runs.
+    struct Selection {
+      Selection() {
+        if (loadActive() == 0) initialize();
+      }
+    } selection;
+
+  } // namespace
+
+  const Kernels::Table& Kernels::table() {
+    const Table* t = loadActive();
+    if (t == 0) t = initialize();
+    return *t;
+  }
+
+  Kernels::Level Kernels::level() {
+    return table().level;
+  }
+
+  Kernels::Level Kernels::supportedLevel() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return AVX2;
+    if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+    return Generic;
+  }
+
+  const char* Kernels::levelName(const Level level) {
+    switch (level) {
+      case SSE2:   return "sse2";
+      case AVX2:   return "avx2";
+      case AVX512: return "avx512";
+      default:     return "generic";
+    }
+  }
+
+  Kernels::Level Kernels::select(const Level level) {
+    const Table* t = tableFor(level < supportedLevel() ? level
+                                                       : supportedLevel());
+    storeActive(t);
+    return t->level;
+  }
+
+} // namespace bps
@@ -0,0 +1,103 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_KERNELS_H
+#define BPS_KERNELS_H
+
+namespace bps {
+
+  // Loops over structure-of-arrays data that are worth vectorizing. The
+  // same source (bps_kernels-impl.h) is compiled once per instruction set
+  // and the best table for the CPU is selected when libbps is loaded. The
+  // environment variable BPS_SIMD_LEVEL (generic, sse2, avx2, avx512)
+  // lowers the level, e.g. for testing; levels the CPU lacks are ignored.
+  class Kernels {
+    public:
+      enum Level { Generic, SSE2, AVX2, AVX512 };
+
+      struct Table {
+        Level level;
+
+        // y += a*x
+        void (*axpy)(const int n, const double a, const double* x,
+                     double* y);
+
+        // x *= a
+        void (*scale)(const int n, const double a, double* x);
+
+        // f_{i-begin} += sum_j s_j (r_i - r_j)/|r_i - r_j|^3 for the
+        // targets i in [begin, end) and all n sources j (coinciding points
+        // are skipped)
+        void (*pairField)(const int n, const double* x, const double* y,
+                          const double* z, const double* s, const int begin,
+                          const int end, double* fx, double* fy, double* fz);
+
+        // v_i = SpecialRelativity::addVelocities(v_i, dv_i)
+        void (*addVelocities)(const int n, double* vx, double* vy,
+                              double* vz, const double* dvx,
+                              const double* dvy, const double* dvz);
+
+        // rotates the points by the 3x3 matrix m (row-major)
+        void (*rotate)(const int n, const double m[9], double* x, double* y,
+                       double* z);
+
+        // applies the 4x4 matrix m (row-major) to the four-vectors
+        // (a0_i, a1_i, a2_i, a3_i)
+        void (*transform4)(const int n, const double m[16], double* a0,
+                           double* a1, double* a2, double* a3);
+
+        // velocities seen from the frame given by the Lorentz matrix m
+        void (*boostVelocities)(const int n, const double m[16], double* vx,
+                                double* vy, double* vz);
+
+        // relativistic Boris step in the fields (e, b): the momenta per
+        // mass u = gamma v move from t - dt/2 to t + dt/2, then the
+        // positions from t to t + dt with the new velocities, which are
+        // stored in v; particles without mass only drift
+        void (*borisPush)(const int n, const double dt, const double* charge,
+                          const double* mass, const double* ex,
+                          const double* ey, const double* ez,
+                          const double* bx, const double* by,
+                          const double* bz, double* x, double* y, double* z,
+                          double* ux, double* uy, double* uz, double* vx,
+                          double* vy, double* vz);
+
+        // free rotation of rigid bodies by dt: body-frame angular momenta
+        // (lx, ly, lz) and orientations (q0, q1, q2, q3) for the principal
+        // moments (ix, iy, iz)
+        void (*rotateBodies)(const int n, const double dt, const double* ix,
+                             const double* iy, const double* iz, double* q0,
+                             double* q1, double* q2, double* q3, double* lx,
+                             double* ly, double* lz);
+      };
+
+      // table selected for this process
+      static const Table& table();
+
+      static Level level();
+      static Level supportedLevel();
+      static const char* levelName(const Level level);
+
+      // switches to the given level if the CPU and the build support it,
+      // returns the level that is active afterwards
+      static Level select(const Level level);
+  };
+
+} // namespace bps
+
+#endif // BPS_KERNELS_H
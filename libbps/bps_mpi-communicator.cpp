@@ -0,0 +1,87 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <mpi.h>
+#include <vector>
+
+#include "bps_mpi-communicator.h"
+
+namespace bps {
+
+  MpiCommunicator::MpiCommunicator(MPI_Comm _comm) : comm(_comm) {}
+
+  int MpiCommunicator::rank() const {
+    int r;
+    MPI_Comm_rank(comm, &r);
+    return r;
+  }
+
+  int MpiCommunicator::size() const {
+    int s;
+    MPI_Comm_size(comm, &s);
+    return s;
+  }
+
+  void MpiCommunicator::sum(double* values, const int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_SUM, comm);
+  }
+
+  void MpiCommunicator::min(double* values, const int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_MIN, comm);
+  }
+
+  void MpiCommunicator::max(double* values, const int n) const {
+    MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  void MpiCommunicator::exchange(
+          const std::vector<std::vector<double> >& sends,
+          std::vector<std::vector<double> >& receives) const {
+    const int ranks = size();
+
+    std::vector<int> sendCounts(ranks), receiveCounts(ranks);
+    for (int r = 0; r < ranks; r++)
+      sendCounts[r] = sends[r].size();
+    MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &receiveCounts[0], 1, MPI_INT,
+                 comm);
+
+    std::vector<int> sendOffsets(ranks, 0), receiveOffsets(ranks, 0);
+    for (int r = 1; r < ranks; r++) {
+      sendOffsets[r] = sendOffsets[r-1] + sendCounts[r-1];
+      receiveOffsets[r] = receiveOffsets[r-1] + receiveCounts[r-1];
+    }
+
+    // one extra element keeps &buffer[0] valid for empty exchanges
+    std::vector<double> sendBuffer(1);
+    for (int r = 0; r < ranks; r++)
+      sendBuffer.insert(sendBuffer.end()-1, sends[r].begin(), sends[r].end());
+    std::vector<double> receiveBuffer(receiveOffsets[ranks-1]
+                                      + receiveCounts[ranks-1] + 1);
+
+    MPI_Alltoallv(&sendBuffer[0], &sendCounts[0], &sendOffsets[0],
+                  MPI_DOUBLE, &receiveBuffer[0], &receiveCounts[0],
+                  &receiveOffsets[0], MPI_DOUBLE, comm);
+
+    receives.resize(ranks);
+    for (int r = 0; r < ranks; r++)
+      receives[r].assign(receiveBuffer.begin() + receiveOffsets[r],
+                         receiveBuffer.begin() + receiveOffsets[r]
+                                               + receiveCounts[r]);
+  }
+
+} // namespace bps
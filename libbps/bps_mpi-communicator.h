@@ -0,0 +1,51 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_MPI_COMMUNICATOR_H
+#define BPS_MPI_COMMUNICATOR_H
+
+#include <mpi.h>
+#include <vector>
+
+#include "bps_communicator.h"
+
+namespace bps {
+
+  // Communicator on top of an MPI communicator. Only available if libbps
+  // was built with MPI; MPI_Init is left to the application.
+  class MpiCommunicator : public Communicator {
+    protected:
+      MPI_Comm comm;
+
+    public:
+      MpiCommunicator(MPI_Comm _comm = MPI_COMM_WORLD);
+
+      int rank() const;
+      int size() const;
+
+      void sum(double* values, const int n) const;
+      void min(double* values, const int n) const;
+      void max(double* values, const int n) const;
+
+      void exchange(const std::vector<std::vector<double> >& sends,
+                    std::vector<std::vector<double> >& receives) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_MPI_COMMUNICATOR_H
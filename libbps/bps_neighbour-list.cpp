@@ -0,0 +1,229 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  CellList::CellList(const double _cellSize, const PeriodicBox& _box)
+          : cellSize(_cellSize), box(_box) {
+    for (int i = 0; i < 3; i++) {
+      width[i] = cellSize;
+      dim[i] = 1;
+    }
+    cellStart.assign(2, 0);
+  }
+
+  CellList& CellList::reconfigure(const double _cellSize,
+                                  const PeriodicBox& _box) {
+    cellSize = _cellSize;
+    box = _box;
+    return *this;
+  }
+
+  CellList& CellList::build(const std::vector<Particle>& particles) {
+    const int n = particles.size();
+
+    double lower[3] = {0, 0, 0};
+    double upper[3] = {0, 0, 0};
+    if (n > 0) {
+      for (int d = 0; d < 3; d++)
+        lower[d] = upper[d] = particles[0].position[d];
+    }
+    for (int i = 1; i < n; i++) {
+      for (int d = 0; d < 3; d++) {
+        lower[d] = std::min(lower[d], particles[i].position[d]);
+        upper[d] = std::max(upper[d], particles[i].position[d]);
+      }
+    }
+    for (int d = 0; d < 3; d++) {
+      if (box.isPeriodic(d)) {
+        lower[d] = 0;
+        upper[d] = box.getLength(d);
+      }
+    }
+
+    for (int d = 0; d < 3; d++)
+      dim[d] = std::max(1, static_cast<int>((upper[d]-lower[d])/cellSize));
+
+    // Sparse systems would otherwise get far more cells than particles,
+    // which makes the grid itself the dominant cost.
+    const double maxCells = 8.0*n + 27;
+    while (static_cast<double>(dim[0])*dim[1]*dim[2] > maxCells) {
+      for (int d = 0; d < 3; d++)
+        dim[d] = std::max(1, dim[d]/2);
+    }
+
+    for (int d = 0; d < 3; d++) {
+      const double extent = upper[d] - lower[d];
+      width[d] = extent > 0 ? extent/dim[d] : cellSize;
+    }
+    origin.set(lower[0], lower[1], lower[2]);
+
+    const int cells = cellCount();
+    cellStart.assign(cells+1, 0);
+    particleCell.resize(n);
+    cellParticles.resize(n);
+
+    for (int i = 0; i < n; i++) {
+      int index[3];
+      for (int d = 0; d < 3; d++) {
+        const double x = box.wrap(particles[i].position[d], d);
+        index[d] = static_cast<int>((x-lower[d])/width[d]);
+        index[d] = std::min(dim[d]-1, std::max(0, index[d]));
+      }
+      particleCell[i] = cellIndex(index[0], index[1], index[2]);
+      cellStart[particleCell[i]+1]++;
+    }
+
+    for (int c = 0; c < cells; c++)
+      cellStart[c+1] += cellStart[c];
+
+    std::vector<int> fill(cellStart.begin(), cellStart.end()-1);
+    for (int i = 0; i < n; i++)
+      cellParticles[fill[particleCell[i]]++] = i;
+
+    return *this;
+  }
+
+  void CellList::neighbourCells(int c, std::vector<int>& cells) const {
+    const int ix = c % dim[0];
+    const int iy = (c / dim[0]) % dim[1];
+    const int iz = c / (dim[0]*dim[1]);
+
+    // per direction the indices of the adjacent cells, wrapped around in
+    // periodic directions and clipped in open ones
+    const int index[3] = {ix, iy, iz};
+    int adjacent[3][3];
+    int count[3] = {0, 0, 0};
+    for (int d = 0; d < 3; d++) {
+      for (int k = index[d]-1; k <= index[d]+1; k++) {
+        int m = k;
+        if (box.isPeriodic(d))
+          m = (k + dim[d]) % dim[d];
+        else if (k < 0 || k >= dim[d])
+          continue;
+
+        // with fewer than three cells the wrapped indices repeat
+        if (std::find(adjacent[d], adjacent[d] + count[d], m)
+            == adjacent[d] + count[d])
+          adjacent[d][count[d]++] = m;
+      }
+    }
+
+    cells.clear();
+    for (int z = 0; z < count[2]; z++)
+      for (int y = 0; y < count[1]; y++)
+        for (int x = 0; x < count[0]; x++)
+          cells.push_back(cellIndex(adjacent[0][x], adjacent[1][y],
+                                    adjacent[2][z]));
+  }
+
+  VerletList::VerletList(const double _cutoff, const double _skin,
+                         const PeriodicBox& _box)
+          : cutoff(_cutoff), skin(_skin), box(_box),
+            cells(_cutoff + _skin, _box), builds(0), invalid(false) {
+    offsets.assign(1, 0);
+  }
+
+  VerletList& VerletList::reconfigure(const double _cutoff,
+                                      const double _skin,
+                                      const PeriodicBox& _box) {
+    cutoff = _cutoff;
+    skin = _skin;
+    box = _box;
+    cells.reconfigure(_cutoff + _skin, _box);
+    // the next update builds the list
+    builds = 0;
+    return *this;
+  }
+
+  VerletList& VerletList::build(const std::vector<Particle>& particles) {
+    const int n = particles.size();
+    const double range = cutoff + skin;
+    const double range_square = range*range;
+
+    cells.build(particles);
+
+    offsets.resize(n+1);
+    neighbours.clear();
+    reference.resize(3*n);
+
+    std::vector<int> adjacent;
+    adjacent.reserve(27);
+
+    for (int i = 0; i < n; i++) {
+      offsets[i] = neighbours.size();
+
+      const ThreeVector& r = particles[i].position;
+      for (int d = 0; d < 3; d++)
+        reference[3*i+d] = r[d];
+
+      cells.neighbourCells(cells.cellOf(i), adjacent);
+      for (unsigned int a = 0; a < adjacent.size(); a++) {
+        const int c = adjacent[a];
+        for (int k = cells.cellBegin(c); k < cells.cellEnd(c); k++) {
+          const int j = cells.cellParticle(k);
+          if (j <= i) continue;
+
+          const ThreeVector& s = particles[j].position;
+          const double dx = box.minimumImage(s[0] - r[0], 0);
+          const double dy = box.minimumImage(s[1] - r[1], 1);
+          const double dz = box.minimumImage(s[2] - r[2], 2);
+          if (dx*dx + dy*dy + dz*dz < range_square)
+            neighbours.push_back(j);
+        }
+      }
+    }
+    offsets[n] = neighbours.size();
+
+    builds++;
+    invalid = false;
+    return *this;
+  }
+
+  bool VerletList::needsRebuild(const std::vector<Particle>& particles)
+          const {
+    const int n = particles.size();
+    if (builds == 0 || invalid || 3*n != static_cast<int>(reference.size()))
+      return true;
+
+    const double limit_square = skin*skin/4;
+    for (int i = 0; i < n; i++) {
+      const ThreeVector& r = particles[i].position;
+      const double dx = box.minimumImage(r[0] - reference[3*i], 0);
+      const double dy = box.minimumImage(r[1] - reference[3*i+1], 1);
+      const double dz = box.minimumImage(r[2] - reference[3*i+2], 2);
+      if (dx*dx + dy*dy + dz*dz > limit_square)
+        return true;
+    }
+    return false;
+  }
+
+  bool VerletList::update(const std::vector<Particle>& particles) {
+    if (!needsRebuild(particles)) return false;
+    build(particles);
+    return true;
+  }
+
+} // namespace bps
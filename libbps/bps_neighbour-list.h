@@ -0,0 +1,129 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_NEIGHBOUR_LIST_H
+#define BPS_NEIGHBOUR_LIST_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  // Uniform grid of cubic cells whose edges are at least cellSize long.
+  // The particle indices are sorted by cell (counting sort), so building
+  // the grid is O(N) and the particles of one cell are contiguous. Along
+  // periodic directions of the box the grid spans the box and wraps around.
+  class CellList {
+    protected:
+      double cellSize;
+      PeriodicBox box;
+      ThreeVector origin;
+      double width[3];
+      int dim[3];
+
+      std::vector<int> cellStart;
+      std::vector<int> cellParticles;
+      std::vector<int> particleCell;
+
+    public:
+      CellList(const double _cellSize = 1,
+               const PeriodicBox& _box = PeriodicBox());
+
+      // new cell size and box; the buffers of earlier builds are kept
+      CellList& reconfigure(const double _cellSize,
+                            const PeriodicBox& _box = PeriodicBox());
+
+      CellList& build(const std::vector<Particle>& particles);
+
+      inline int cellCount() const { return dim[0]*dim[1]*dim[2]; }
+      inline int dimension(int i) const { return dim[i]; }
+
+      inline int cellIndex(int ix, int iy, int iz) const {
+        return (iz*dim[1] + iy)*dim[0] + ix;
+      }
+
+      // cell of the i-th particle of the last build
+      inline int cellOf(int i) const { return particleCell[i]; }
+
+      // particles in cell c are cellParticle(k) for k in [begin, end)
+      inline int cellBegin(int c) const { return cellStart[c]; }
+      inline int cellEnd(int c) const { return cellStart[c+1]; }
+      inline int cellParticle(int k) const { return cellParticles[k]; }
+
+      // indices of the (up to 27) cells adjacent to cell c, including c
+      void neighbourCells(int c, std::vector<int>& cells) const;
+  };
+
+  // Half Verlet list (each pair i < j is stored once) of all pairs closer
+  // than cutoff + skin. The list stays valid until some particle has moved
+  // more than skin/2 since the last build. Distances in periodic boxes are
+  // those to the nearest image, which requires cutoff + skin <= L/2.
+  class VerletList {
+    protected:
+      double cutoff;
+      double skin;
+      PeriodicBox box;
+
+      CellList cells;
+      std::vector<int> offsets;
+      std::vector<int> neighbours;
+      std::vector<double> reference;
+
+      int builds;
+      bool invalid;
+
+    public:
+      VerletList(const double _cutoff, const double _skin,
+                 const PeriodicBox& _box = PeriodicBox());
+
+      // starts over like a new list with these parameters, but keeps the
+      // buffers of earlier builds
+      VerletList& reconfigure(const double _cutoff, const double _skin,
+                              const PeriodicBox& _box = PeriodicBox());
+
+      VerletList& build(const std::vector<Particle>& particles);
+      bool needsRebuild(const std::vector<Particle>& particles) const;
+
+      // makes the next update rebuild the list, e.g. because the particles
+      // have been exchanged or reordered
+      inline VerletList& invalidate() {
+        invalid = true;
+        return *this;
+      }
+
+      // rebuilds the list if necessary, returns true if it did so
+      bool update(const std::vector<Particle>& particles);
+
+      inline double getCutoff() const { return cutoff; }
+      inline double getSkin() const { return skin; }
+      inline const PeriodicBox& getBox() const { return box; }
+      inline int buildCount() const { return builds; }
+      inline int pairCount() const { return neighbours.size(); }
+
+      // neighbours of particle i are neighbour(k) for k in [begin, end)
+      inline int neighbourBegin(int i) const { return offsets[i]; }
+      inline int neighbourEnd(int i) const { return offsets[i+1]; }
+      inline int neighbour(int k) const { return neighbours[k]; }
+  };
+
+} // namespace bps
+
+#endif // BPS_NEIGHBOUR_LIST_H
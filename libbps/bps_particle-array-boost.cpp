@@ -0,0 +1,66 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_constants.h"
+#include "bps_kernels.h"
+#include "bps_particle-array.h"
+#include "bps_particle-array-boost.h"
+#include "bps_relativity.h"
+
+namespace bps {
+
+  ParticleArrayBoost::ParticleArrayBoost(const ThreeVector& _velocity)
+          : LorentzBoost(_velocity) {}
+
+  ParticleArrayBoost::ParticleArrayBoost(const LorentzBoost& boost)
+          : LorentzBoost(boost) {}
+
+  void ParticleArrayBoost::apply(ParticleArray& particles,
+                                 std::vector<double>& time) const {
+    const int n = particles.size();
+    if (n == 0) return;
+
+    // the same matrix for (t, x, y, z) instead of (ct, x, y, z)
+    const double c = BPS_CONST_SPEED_OF_LIGHT;
+    double m[16];
+    for (int k = 0; k < 16; k++)
+      m[k] = matrix[k];
+    for (int i = 1; i < 4; i++) {
+      m[i] /= c;
+      m[4*i] *= c;
+    }
+
+    time.resize(n);
+    Kernels::table().transform4(n, m, &time[0], &particles.x[0],
+                                &particles.y[0], &particles.z[0]);
+    applyToVelocities(particles);
+  }
+
+  void ParticleArrayBoost::applyToVelocities(ParticleArray& particles) const {
+    const int n = particles.size();
+    if (n == 0) return;
+
+    Kernels::table().boostVelocities(n, matrix, &particles.vx[0],
+                                     &particles.vy[0], &particles.vz[0]);
+  }
+
+} // namespace bps
@@ -0,0 +1,48 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BPS_PARTICLE_ARRAY_BOOST_H
+#define BPS_PARTICLE_ARRAY_BOOST_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle-array.h"
+#include "bps_relativity.h"
+
+namespace bps {
+
+  // LorentzBoost of whole ParticleArrays in one vectorized pass.
+  class ParticleArrayBoost : public LorentzBoost {
+    public:
+      ParticleArrayBoost(const ThreeVector& _velocity = ThreeVector());
+      ParticleArrayBoost(const LorentzBoost& boost);
+
+      using LorentzBoost::apply;
+
+      // events (time[i], position of particle i) and the velocities of all
+      // particles; time is in seconds. Boosting the velocities also boosts
+      // the momenta gamma m v, since the masses are invariant.
+      void apply(ParticleArray& particles, std::vector<double>& time) const;
+      void applyToVelocities(ParticleArray& particles) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_PARTICLE_ARRAY_BOOST_H
@@ -0,0 +1,207 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_constants.h"
+#include "bps_kernels.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_quaternion.h"
+
+namespace bps {
+
+  namespace {
+
+    // targets per task of the all-pairs kernels
+    const int pairBlock = 64;
+
+    // f_i = sum_j s_j (r_i - r_j)/|r_i - r_j|^3 for the particles i in
+    // [begin, end), stored at f[i-begin]
+    void pairField(const ParticleArray& a, const std::vector<double>& s,
+                   const int begin, const int end, std::vector<double>& fx,
+                   std::vector<double>& fy, std::vector<double>& fz) {
+      fx.assign(end - begin, 0);
+      fy.assign(end - begin, 0);
+      fz.assign(end - begin, 0);
+      if (end <= begin) return;
+
+      Kernels::table().pairField(a.size(), &a.x[0], &a.y[0], &a.z[0], &s[0],
+                                 begin, end, &fx[0], &fy[0], &fz[0]);
+    }
+
+  } // namespace
+
+  ParticleArray::ParticleArray(const int n) {
+    resize(n);
+  }
+
+  ParticleArray::ParticleArray(const std::vector<Particle>& particles) {
+    load(particles);
+  }
+
+  ParticleArray& ParticleArray::resize(const int n) {
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    vx.resize(n);
+    vy.resize(n);
+    vz.resize(n);
+    dvx.resize(n);
+    dvy.resize(n);
+    dvz.resize(n);
+    mass.resize(n);
+    charge.resize(n);
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::load(const std::vector<Particle>& particles) {
+    const int n = particles.size();
+    resize(n);
+    for (int i = 0; i < n; i++)
+      set(i, particles[i]);
+    return *this;
+  }
+
+  void ParticleArray::store(std::vector<Particle>& particles) const {
+    const int n = size();
+    particles.resize(n);
+    for (int i = 0; i < n; i++)
+      particles[i] = get(i);
+  }
+
+  Particle ParticleArray::get(const int i) const {
+    Particle p(ThreeVector(x[i], y[i], z[i]),
+               ThreeVector(vx[i], vy[i], vz[i]), mass[i], charge[i]);
+    p.dv.set(dvx[i], dvy[i], dvz[i]);
+    return p;
+  }
+
+  ParticleArray& ParticleArray::set(const int i, const Particle& p) {
+    x[i] = p.position[0];
+    y[i] = p.position[1];
+    z[i] = p.position[2];
+    vx[i] = p.velocity[0];
+    vy[i] = p.velocity[1];
+    vz[i] = p.velocity[2];
+    dvx[i] = p.dv[0];
+    dvy[i] = p.dv[1];
+    dvz[i] = p.dv[2];
+    mass[i] = p.mass;
+    charge[i] = p.charge;
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::clearDv() {
+    std::fill(dvx.begin(), dvx.end(), 0.0);
+    std::fill(dvy.begin(), dvy.end(), 0.0);
+    std::fill(dvz.begin(), dvz.end(), 0.0);
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::updatePositions(const double dt) {
+    const int n = size();
+    if (n == 0) return *this;
+
+    const Kernels::Table& kernels = Kernels::table();
+    kernels.addVelocities(n, &vx[0], &vy[0], &vz[0],
+                          &dvx[0], &dvy[0], &dvz[0]);
+    kernels.axpy(n, dt, &vx[0], &x[0]);
+    kernels.axpy(n, dt, &vy[0], &y[0]);
+    kernels.axpy(n, dt, &vz[0], &z[0]);
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::gravitationalForces(const double dt) {
+    const int n = size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int begin = 0; begin < n; begin += pairBlock)
+      gravitationalForces(dt, begin, std::min(n, begin + pairBlock));
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::gravitationalForces(const double dt,
+                                                    const int begin,
+                                                    const int end) {
+    std::vector<double> fx, fy, fz;
+    pairField(*this, mass, begin, end, fx, fy, fz);
+
+    const double G = BPS_CONST_GRAVITATIONAL_CONSTANT;
+    for (int i = begin; i < end; i++) {
+      if (mass[i] == 0) continue;
+      dvx[i] -= dt*G*fx[i-begin];
+      dvy[i] -= dt*G*fy[i-begin];
+      dvz[i] -= dt*G*fz[i-begin];
+    }
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::coloumbForces(const double dt) {
+    const int n = size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int begin = 0; begin < n; begin += pairBlock)
+      coloumbForces(dt, begin, std::min(n, begin + pairBlock));
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::coloumbForces(const double dt,
+                                              const int begin,
+                                              const int end) {
+    std::vector<double> fx, fy, fz;
+    pairField(*this, charge, begin, end, fx, fy, fz);
+
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    for (int i = begin; i < end; i++) {
+      if (charge[i] == 0 || mass[i] == 0) continue;
+      const double f = (dt/mass[i])*k*charge[i];
+      dvx[i] += f*fx[i-begin];
+      dvy[i] += f*fy[i-begin];
+      dvz[i] += f*fz[i-begin];
+    }
+    return *this;
+  }
+
+  ParticleArray& ParticleArray::rotate(const ThreeVector& axis,
+                                       const double angle) {
+    const int n = size();
+    if (n == 0) return *this;
+
+    // matrix of v -> q v q* (see ThreeVector::rotate)
+    const Quaternion q(std::cos(angle/2), std::sin(angle/2)*axis.normalized());
+    const double w = q.getRe();
+    const double a = q.getIm1();
+    const double b = q.getIm2();
+    const double c = q.getIm3();
+    const double m[9] = {
+      1 - 2*(b*b + c*c), 2*(a*b - w*c),     2*(a*c + w*b),
+      2*(a*b + w*c),     1 - 2*(a*a + c*c), 2*(b*c - w*a),
+      2*(a*c - w*b),     2*(b*c + w*a),     1 - 2*(a*a + b*b)
+    };
+
+    const Kernels::Table& kernels = Kernels::table();
+    kernels.rotate(n, m, &x[0], &y[0], &z[0]);
+    kernels.rotate(n, m, &vx[0], &vy[0], &vz[0]);
+    return *this;
+  }
+
+} // namespace bps
@@ -0,0 +1,75 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_PARTICLE_ARRAY_H
+#define BPS_PARTICLE_ARRAY_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle.h"
+
+namespace bps {
+
+  // Particles stored as structure of arrays. The bulk operations do the
+  // same as the corresponding Particle methods applied to every particle
+  // (or pair), but run through the vectorized kernels of bps_kernels.h.
+  class ParticleArray {
+    public:
+      std::vector<double> x, y, z;
+      std::vector<double> vx, vy, vz;
+      std::vector<double> dvx, dvy, dvz;
+      std::vector<double> mass;
+      std::vector<double> charge;
+
+    public:
+      ParticleArray(const int n = 0);
+      ParticleArray(const std::vector<Particle>& particles);
+
+      inline int size() const { return x.size(); }
+      ParticleArray& resize(const int n);
+
+      ParticleArray& load(const std::vector<Particle>& particles);
+      void store(std::vector<Particle>& particles) const;
+
+      Particle get(const int i) const;
+      ParticleArray& set(const int i, const Particle& p);
+
+      ParticleArray& clearDv();
+
+      // Particle::updatePosition for all particles
+      ParticleArray& updatePositions(const double dt);
+
+      // Particle::gravitationalForce and coloumbForce for all pairs
+      ParticleArray& gravitationalForces(const double dt);
+      ParticleArray& coloumbForces(const double dt);
+
+      // the same for the targets in [begin, end) only (serial), e.g. for
+      // one tile of a StepPipeline
+      ParticleArray& gravitationalForces(const double dt, const int begin,
+                                         const int end);
+      ParticleArray& coloumbForces(const double dt, const int begin,
+                                   const int end);
+
+      // rotates positions and velocities about an axis through the origin
+      ParticleArray& rotate(const ThreeVector& axis, const double angle);
+  };
+
+} // namespace bps
+
+#endif // BPS_PARTICLE_ARRAY_H
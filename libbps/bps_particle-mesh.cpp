@@ -0,0 +1,242 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_fft.h"
+#include "bps_particle.h"
+#include "bps_particle-mesh.h"
+
+namespace bps {
+
+  // Particles are binned into slabs of this many grid planes along x. An
+  // assignment stencil never reaches further than two planes beyond its
+  // slab, so slabs of equal parity can be filled concurrently.
+  static const int slabWidth = 4;
+
+  ParticleMesh::ParticleMesh(const int gridSize, const Assignment _assignment)
+          : n(FourierTransform::nextPowerOfTwo(std::max(gridSize, 8))),
+            assignment(_assignment), h(1) {
+    for (int d = 0; d < 3; d++)
+      origin[d] = 0;
+  }
+
+  void ParticleMesh::setupGrid(const std::vector<Particle>& particles) {
+    double lower[3], upper[3];
+    for (int d = 0; d < 3; d++)
+      lower[d] = upper[d] = particles[0].position[d];
+    for (unsigned int i = 1; i < particles.size(); i++) {
+      for (int d = 0; d < 3; d++) {
+        lower[d] = std::min(lower[d], particles[i].position[d]);
+        upper[d] = std::max(upper[d], particles[i].position[d]);
+      }
+    }
+
+    double extent = 0;
+    for (int d = 0; d < 3; d++)
+      extent = std::max(extent, upper[d] - lower[d]);
+
+    // Two spare planes on each side keep the stencils and the central
+    // differences of the gradient inside the grid.
+    h = extent > 0 ? extent/(n-5) : 1;
+    for (int d = 0; d < 3; d++)
+      origin[d] = lower[d] - 2*h;
+  }
+
+  void ParticleMesh::stencil(const double u, int& first, double w[3]) const {
+    if (assignment == CIC) {
+      first = static_cast<int>(std::floor(u));
+      const double f = u - first;
+      w[0] = 1 - f;
+      w[1] = f;
+      w[2] = 0;
+    } else {
+      const int i = static_cast<int>(std::floor(u + 0.5));
+      const double f = u - i;
+      first = i - 1;
+      w[0] = 0.5*(0.5 - f)*(0.5 - f);
+      w[1] = 0.75 - f*f;
+      w[2] = 0.5*(0.5 + f)*(0.5 + f);
+    }
+  }
+
+  void ParticleMesh::assign(const std::vector<Particle>& particles,
+                            const bool charges) {
+    const int np = particles.size();
+    const int slabs = n/slabWidth;
+    const int width = assignment == CIC ? 2 : 3;
+
+    source.assign(n*n*n, 0);
+
+    // counting sort of the particles by slab
+    std::vector<int> slabOf(np);
+    slabStart.assign(slabs+1, 0);
+    for (int i = 0; i < np; i++) {
+      int first;
+      double w[3];
+      stencil((particles[i].position[0] - origin[0])/h, first, w);
+      slabOf[i] = std::min(slabs-1, first/slabWidth);
+      slabStart[slabOf[i]+1]++;
+    }
+    for (int s = 0; s < slabs; s++)
+      slabStart[s+1] += slabStart[s];
+    std::vector<int> fill(slabStart.begin(), slabStart.end()-1);
+    slabParticles.resize(np);
+    for (int i = 0; i < np; i++)
+      slabParticles[fill[slabOf[i]]++] = i;
+
+    for (int color = 0; color < 2; color++) {
+      #pragma omp parallel for schedule(dynamic)
+      for (int s = color; s < slabs; s += 2) {
+        for (int k = slabStart[s]; k < slabStart[s+1]; k++) {
+          const Particle& p = particles[slabParticles[k]];
+          const double value = charges ? p.charge : p.mass;
+          if (value == 0) continue;
+
+          int first[3];
+          double w[3][3];
+          for (int d = 0; d < 3; d++)
+            stencil((p.position[d] - origin[d])/h, first[d], w[d]);
+
+          for (int a = 0; a < width; a++)
+            for (int b = 0; b < width; b++)
+              for (int c = 0; c < width; c++)
+                source[((first[0]+a)*n + first[1]+b)*n + first[2]+c]
+                  += value*w[0][a]*w[1][b]*w[2][c];
+        }
+      }
+    }
+  }
+
+  void ParticleMesh::solve() {
+    const int m = 2*n;
+
+    // Fourier transform of 1/r (in units of h) on the doubled grid, which
+    // turns the cyclic convolution into the open boundary one.
+    if (green.empty()) {
+      green.assign(m*m*m, 0);
+      for (int i = 0; i < m; i++) {
+        const int x = i < n ? i : i - m;
+        for (int j = 0; j < m; j++) {
+          const int y = j < n ? j : j - m;
+          for (int k = 0; k < m; k++) {
+            const int z = k < n ? k : k - m;
+            if (i == n || j == n || k == n) continue;
+            const double r = std::sqrt(static_cast<double>(x*x + y*y + z*z));
+            green[(i*m + j)*m + k] = r > 0 ? 1/r : 1;
+          }
+        }
+      }
+      FourierTransform::transform3d(green, m, m, m);
+    }
+
+    work.assign(m*m*m, 0);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        for (int k = 0; k < n; k++)
+          work[(i*m + j)*m + k] = source[(i*n + j)*n + k];
+
+    FourierTransform::transform3d(work, m, m, m);
+    for (int i = 0; i < m*m*m; i++)
+      work[i] *= green[i];
+    FourierTransform::transform3d(work, m, m, m, true);
+
+    potential.resize(n*n*n);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        for (int k = 0; k < n; k++)
+          potential[(i*n + j)*n + k] = work[(i*m + j)*m + k].real()/h;
+  }
+
+  void ParticleMesh::interpolate(const Particle& p, double gradient[3]) const {
+    const int width = assignment == CIC ? 2 : 3;
+    const int step[3] = {n*n, n, 1};
+
+    int first[3];
+    double w[3][3];
+    for (int d = 0; d < 3; d++) {
+      stencil((p.position[d] - origin[d])/h, first[d], w[d]);
+      gradient[d] = 0;
+    }
+
+    for (int a = 0; a < width; a++)
+      for (int b = 0; b < width; b++)
+        for (int c = 0; c < width; c++) {
+          const int index = ((first[0]+a)*n + first[1]+b)*n + first[2]+c;
+          const double weight = w[0][a]*w[1][b]*w[2][c];
+          for (int d = 0; d < 3; d++)
+            gradient[d] += weight*(potential[index+step[d]]
+                                   - potential[index-step[d]]);
+        }
+
+    for (int d = 0; d < 3; d++)
+      gradient[d] /= 2*h;
+  }
+
+  ParticleMesh& ParticleMesh::gravitationalForce(
+          std::vector<Particle>& particles, const double dt) {
+    if (particles.empty()) return *this;
+
+    setupGrid(particles);
+    assign(particles, false);
+    solve();
+
+    const double G = BPS_CONST_GRAVITATIONAL_CONSTANT;
+    const int np = particles.size();
+
+    #pragma omp parallel for
+    for (int i = 0; i < np; i++) {
+      Particle& p = particles[i];
+      if (p.mass == 0) continue;
+
+      double gradient[3];
+      interpolate(p, gradient);
+      for (int d = 0; d < 3; d++)
+        p.dv[d] += dt*G*gradient[d];
+    }
+    return *this;
+  }
+
+  ParticleMesh& ParticleMesh::coloumbForce(std::vector<Particle>& particles,
+                                           const double dt) {
+    if (particles.empty()) return *this;
+
+    setupGrid(particles);
+    assign(particles, true);
+    solve();
+
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const int np = particles.size();
+
+    #pragma omp parallel for
+    for (int i = 0; i < np; i++) {
+      Particle& p = particles[i];
+      if (p.charge == 0 || p.mass == 0) continue;
+
+      double gradient[3];
+      interpolate(p, gradient);
+      for (int d = 0; d < 3; d++)
+        p.dv[d] -= (dt/p.mass)*k*p.charge*gradient[d];
+    }
+    return *this;
+  }
+
+} // namespace bps
@@ -0,0 +1,75 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_PARTICLE_MESH_H
+#define BPS_PARTICLE_MESH_H
+
+#include <vector>
+
+#include "bps_fft.h"
+#include "bps_particle.h"
+
+namespace bps {
+
+  // Long-range Coloumb and gravitational forces with open boundaries on a
+  // cubic grid of gridSize^3 points spanning the bounding box of the
+  // particles. Charges or masses are assigned to the grid, the potential is
+  // the FFT convolution with 1/r on a zero-padded grid (Hockney-Eastwood)
+  // and the field is interpolated back with the same assignment scheme.
+  class ParticleMesh {
+    public:
+      // cloud-in-cell (2^3 points) or triangular shaped cloud (3^3 points)
+      enum Assignment { CIC, TSC };
+
+    protected:
+      int n;
+      Assignment assignment;
+
+      double h;
+      double origin[3];
+
+      std::vector<double> source;
+      std::vector<double> potential;
+      std::vector<FourierTransform::complex> green;
+      std::vector<FourierTransform::complex> work;
+
+      std::vector<int> slabStart;
+      std::vector<int> slabParticles;
+
+      void setupGrid(const std::vector<Particle>& particles);
+      void stencil(const double u, int& first, double w[3]) const;
+      void assign(const std::vector<Particle>& particles, const bool charges);
+      void solve();
+      void interpolate(const Particle& p, double gradient[3]) const;
+
+    public:
+      // gridSize is rounded up to a power of two
+      ParticleMesh(const int gridSize = 64, const Assignment _assignment = CIC);
+
+      ParticleMesh& gravitationalForce(std::vector<Particle>& particles,
+                                       const double dt);
+      ParticleMesh& coloumbForce(std::vector<Particle>& particles,
+                                 const double dt);
+
+      inline int gridSize() const { return n; }
+      inline double gridSpacing() const { return h; }
+  };
+
+} // namespace bps
+
+#endif // BPS_PARTICLE_MESH_H
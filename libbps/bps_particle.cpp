@@ -18,10 +18,11 @@
 
 #include <cmath>
 
+#include "bps_3-vector.h"
 #include "bps_constants.h"
 #include "bps_particle.h"
+#include "bps_periodic-box.h"
 #include "bps_relativity.h"
-#include "bps_vector.h"
 
 namespace bps {
 
@@ -31,11 +32,17 @@ namespace bps {
     return *this;
   }
 
+  Particle& Particle::updatePosition(const double dt, const PeriodicBox& box) {
+    updatePosition(dt);
+    box.wrap(position);
+    return *this;
+  }
+
   Particle& Particle::gravitationalForce(Particle& p, const double dt) {
     if (mass == 0 || p.mass == 0) return *this;
 
     const double G = BPS_CONST_GRAVITATIONAL_CONSTANT;
-    const Vector r = position - p.position;
+    const ThreeVector r = position - p.position;
     p.dv += dt*G*mass*r/std::pow(r.length(),3);
     return *this;
   }
@@ -44,9 +51,21 @@ namespace bps {
     if (charge == 0 || p.charge == 0) return *this;
 
     const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
-    const Vector r = p.position - position;
+    const ThreeVector r = p.position - position;
     p.dv += (dt/p.mass)*k*p.charge*charge*r/std::pow(r.length(),3);
     return *this;
   }
 
+  Particle& Particle::screenedColoumbForce(Particle& p, const double dt,
+                                           const double debyeLength) {
+    if (charge == 0 || p.charge == 0) return *this;
+
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const ThreeVector r = p.position - position;
+    const double l = r.length();
+    const double screening = std::exp(-l/debyeLength)*(1 + l/debyeLength);
+    p.dv += (dt/p.mass)*k*p.charge*charge*screening*r/std::pow(l,3);
+    return *this;
+  }
+
 } // namespace bps
@@ -19,28 +19,34 @@
 #ifndef BPS_PARTICLE_H
 #define BPS_PARTICLE_H
 
-#include "bps_vector.h"
+#include "bps_3-vector.h"
+#include "bps_periodic-box.h"
 
 namespace bps {
 
   class Particle {
     public:
-      Vector position;
-      Vector velocity, dv;
+      ThreeVector position;
+      ThreeVector velocity, dv;
 
       double mass;
       double charge;
 
     public:
-      inline Particle(const Vector& p = Vector(0,0,0),
-                      const Vector& v = Vector(0,0,0),
+      inline Particle(const ThreeVector& p = ThreeVector(0,0,0),
+                      const ThreeVector& v = ThreeVector(0,0,0),
                       double m = 0, double q = 0)
               : position(p), velocity(v), mass(m), charge(q) {}
 
       Particle& updatePosition(const double dt);
+      Particle& updatePosition(const double dt, const PeriodicBox& box);
 
       Particle& gravitationalForce(Particle& p, const double dt);
       Particle& coloumbForce(Particle& p, const double dt);
+
+      // Coloumb force screened by a Yukawa (Debye-Hueckel) potential
+      Particle& screenedColoumbForce(Particle& p, const double dt,
+                                     const double debyeLength);
   };
 
 } // namespace bps
@@ -0,0 +1,36 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bps_3-vector.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  ThreeVector& PeriodicBox::wrap(ThreeVector& r) const {
+    for (int d = 0; d < 3; d++)
+      r[d] = wrap(r[d], d);
+    return r;
+  }
+
+  ThreeVector& PeriodicBox::minimumImage(ThreeVector& r) const {
+    for (int d = 0; d < 3; d++)
+      r[d] = minimumImage(r[d], d);
+    return r;
+  }
+
+} // namespace bps
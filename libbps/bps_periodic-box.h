@@ -0,0 +1,72 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_PERIODIC_BOX_H
+#define BPS_PERIODIC_BOX_H
+
+#include <cmath>
+
+#include "bps_3-vector.h"
+
+namespace bps {
+
+  // Box [0, Lx) x [0, Ly) x [0, Lz) with periodic boundaries. A length of
+  // zero leaves that direction open, so the default box is not periodic
+  // at all.
+  class PeriodicBox {
+    protected:
+      double length[3];
+
+    public:
+      inline PeriodicBox(double lx = 0, double ly = 0, double lz = 0) {
+        length[0] = lx;
+        length[1] = ly;
+        length[2] = lz;
+      }
+
+      inline double getLength(int d) const { return length[d]; }
+      inline bool isPeriodic(int d) const { return length[d] > 0; }
+
+      inline bool isPeriodic() const {
+        return isPeriodic(0) || isPeriodic(1) || isPeriodic(2);
+      }
+
+      inline double volume() const {
+        return length[0]*length[1]*length[2];
+      }
+
+      // coordinate mapped into [0, L)
+      inline double wrap(double x, int d) const {
+        if (!isPeriodic(d)) return x;
+        x -= length[d]*std::floor(x/length[d]);
+        return x < length[d] ? x : 0;
+      }
+
+      // separation mapped to its nearest periodic image
+      inline double minimumImage(double dx, int d) const {
+        if (!isPeriodic(d)) return dx;
+        return dx - length[d]*std::floor(dx/length[d] + 0.5);
+      }
+
+      ThreeVector& wrap(ThreeVector& r) const;
+      ThreeVector& minimumImage(ThreeVector& r) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_PERIODIC_BOX_H
@@ -17,25 +17,82 @@
 */
 
 #include <cmath>
+#include <stdexcept>
 
+#include "bps_3-vector.h"
+#include "bps_4-vector.h"
 #include "bps_constants.h"
+#include "bps_kernels.h"
 #include "bps_relativity.h"
-#include "bps_vector.h"
 
 namespace bps {
 
-  Vector SpecialRelativity::addVelocities(const Vector& v1, const Vector& v2) {
-    const Vector n = v2.normalized();
-    const Vector v1_parallel = (v1*n)*n;
-    const Vector v1_perpendicular = v1 - v1_parallel;
+  ThreeVector SpecialRelativity::addVelocities(const ThreeVector& v1,
+                                              const ThreeVector& v2) {
+    if (v2.length() == 0) return v1;
+
+    const ThreeVector n = v2.normalized();
+    const ThreeVector v1_parallel = (v1*n)*n;
+    const ThreeVector v1_perpendicular = v1 - v1_parallel;
 
     const double c_square = std::pow(BPS_CONST_SPEED_OF_LIGHT,2);
     const double gamma = std::sqrt(1 - v2*v2/c_square);
 
     const double denominator = 1 + v1*v2/c_square;
-    const Vector numerator = v1_parallel + v2 + gamma*v1_perpendicular;
+    const ThreeVector numerator = v1_parallel + v2 + gamma*v1_perpendicular;
 
     return numerator/denominator;
   }
 
+  LorentzBoost::LorentzBoost(const ThreeVector& _velocity)
+          : velocity(_velocity) {
+    const ThreeVector beta = velocity/BPS_CONST_SPEED_OF_LIGHT;
+    const double beta_square = beta*beta;
+    if (!(beta_square < 1))
+      throw std::invalid_argument(
+          "LorentzBoost: the velocity must be below the speed of light");
+    const double gamma = 1/std::sqrt(1 - beta_square);
+    const double f = beta_square > 0 ? (gamma - 1)/beta_square : 0;
+
+    matrix[0] = gamma;
+    for (int i = 0; i < 3; i++) {
+      matrix[1+i] = -gamma*beta[i];
+      matrix[4*(1+i)] = -gamma*beta[i];
+      for (int j = 0; j < 3; j++)
+        matrix[4*(1+i) + 1+j] = (i == j ? 1 : 0) + f*beta[i]*beta[j];
+    }
+  }
+
+  LorentzBoost LorentzBoost::fromRapidity(const ThreeVector& direction,
+                                          const double rapidity) {
+    if (direction.length() == 0) return LorentzBoost();
+    return LorentzBoost(BPS_CONST_SPEED_OF_LIGHT*std::tanh(rapidity)
+                        *direction.normalized());
+  }
+
+  double LorentzBoost::getGamma() const {
+    return matrix[0];
+  }
+
+  double LorentzBoost::getRapidity() const {
+    return std::atanh(velocity.length()/BPS_CONST_SPEED_OF_LIGHT);
+  }
+
+  LorentzBoost LorentzBoost::inverse() const {
+    return LorentzBoost(-velocity);
+  }
+
+  FourVector LorentzBoost::apply(const FourVector& a) const {
+    FourVector b;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+        b[i] += matrix[4*i + j]*a[j];
+    return b;
+  }
+
+  void LorentzBoost::apply(const int n, double* a0, double* a1, double* a2,
+                           double* a3) const {
+    Kernels::table().transform4(n, matrix, a0, a1, a2, a3);
+  }
+
 } // namespace bps
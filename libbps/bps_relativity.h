@@ -19,13 +19,47 @@
 #ifndef BPS_RELATIVITY_H
 #define BPS_RELATIVITY_H
 
-#include "bps_vector.h"
+#include "bps_3-vector.h"
+#include "bps_4-vector.h"
 
 namespace bps {
 
   class SpecialRelativity {
     public:
-      static Vector addVelocities(const Vector& v1, const Vector& v2);
+      static ThreeVector addVelocities(const ThreeVector& v1, const ThreeVector& v2);
+  };
+
+  // Lorentz transformation into a frame that moves with the given velocity,
+  // precomputed as a 4x4 matrix acting on (ct, x, y, z). The bulk method
+  // transforms whole arrays in one vectorized pass (see bps_kernels.h);
+  // ParticleArrayBoost does the same for particles.
+  class LorentzBoost {
+    protected:
+      ThreeVector velocity;
+      double matrix[16];
+
+    public:
+      // throws std::invalid_argument unless |velocity| < c
+      LorentzBoost(const ThreeVector& _velocity = ThreeVector());
+
+      // a zero direction gives the identity; rapidities so large that the
+      // speed rounds to c are rejected like such velocities
+      static LorentzBoost fromRapidity(const ThreeVector& direction,
+                                       const double rapidity);
+
+      inline const ThreeVector& getVelocity() const { return velocity; }
+      double getGamma() const;
+      double getRapidity() const;
+
+      // boost back into the original frame
+      LorentzBoost inverse() const;
+
+      FourVector apply(const FourVector& a) const;
+
+      // four-vectors (a0_i, a1_i, a2_i, a3_i), e.g. events (c t, x, y, z)
+      // or four-momenta (E/c, px, py, pz)
+      void apply(const int n, double* a0, double* a1, double* a2,
+                 double* a3) const;
   };
 
 } // namespace bps
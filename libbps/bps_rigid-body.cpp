@@ -0,0 +1,362 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_kernels.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_quaternion.h"
+#include "bps_rigid-body.h"
+
+namespace bps {
+
+  namespace {
+
+    // matrix of v -> q v q* (row-major) for a unit quaternion
+    void rotationMatrix(const double w, const double a, const double b,
+                        const double c, double m[9]) {
+      m[0] = 1 - 2*(b*b + c*c);
+      m[1] = 2*(a*b - w*c);
+      m[2] = 2*(a*c + w*b);
+      m[3] = 2*(a*b + w*c);
+      m[4] = 1 - 2*(a*a + c*c);
+      m[5] = 2*(b*c - w*a);
+      m[6] = 2*(a*c - w*b);
+      m[7] = 2*(b*c + w*a);
+      m[8] = 1 - 2*(a*a + b*b);
+    }
+
+    // unit quaternion of a proper rotation matrix (row-major)
+    Quaternion rotationQuaternion(const double m[9]) {
+      const double trace = m[0] + m[4] + m[8];
+      if (trace > 0) {
+        const double s = 2*std::sqrt(1 + trace);
+        return Quaternion(s/4, (m[7] - m[5])/s, (m[2] - m[6])/s,
+                          (m[3] - m[1])/s);
+      } else if (m[0] > m[4] && m[0] > m[8]) {
+        const double s = 2*std::sqrt(1 + m[0] - m[4] - m[8]);
+        return Quaternion((m[7] - m[5])/s, s/4, (m[1] + m[3])/s,
+                          (m[2] + m[6])/s);
+      } else if (m[4] > m[8]) {
+        const double s = 2*std::sqrt(1 + m[4] - m[0] - m[8]);
+        return Quaternion((m[2] - m[6])/s, (m[1] + m[3])/s, s/4,
+                          (m[5] + m[7])/s);
+      } else {
+        const double s = 2*std::sqrt(1 + m[8] - m[0] - m[4]);
+        return Quaternion((m[3] - m[1])/s, (m[2] + m[6])/s,
+                          (m[5] + m[7])/s, s/4);
+      }
+    }
+
+    // Diagonalizes the symmetric matrix a (row-major) with cyclic Jacobi
+    // rotations. The eigenvalues end up on the diagonal of a, the
+    // eigenvectors in the columns of v, which is made a proper rotation.
+    void diagonalize(double a[9], double v[9]) {
+      for (int i = 0; i < 9; i++)
+        v[i] = i % 4 == 0 ? 1 : 0;
+
+      for (int sweep = 0; sweep < 50; sweep++) {
+        const double off = a[1]*a[1] + a[2]*a[2] + a[5]*a[5];
+        const double diag = a[0]*a[0] + a[4]*a[4] + a[8]*a[8];
+        if (off <= 1e-30*diag) break;
+
+        for (int p = 0; p < 2; p++)
+          for (int q = p+1; q < 3; q++) {
+            const double apq = a[3*p + q];
+            if (apq == 0) continue;
+
+            const double theta = (a[3*q + q] - a[3*p + p])/(2*apq);
+            const double t = (theta >= 0 ? 1 : -1)
+                             /(std::fabs(theta) + std::sqrt(theta*theta + 1));
+            const double c = 1/std::sqrt(t*t + 1);
+            const double s = t*c;
+
+            // a = J^T a J, v = v J
+            for (int k = 0; k < 3; k++) {
+              const double akp = a[3*k + p];
+              const double akq = a[3*k + q];
+              a[3*k + p] = c*akp - s*akq;
+              a[3*k + q] = s*akp + c*akq;
+            }
+            for (int k = 0; k < 3; k++) {
+              const double apk = a[3*p + k];
+              const double aqk = a[3*q + k];
+              a[3*p + k] = c*apk - s*aqk;
+              a[3*q + k] = s*apk + c*aqk;
+            }
+            for (int k = 0; k < 3; k++) {
+              const double vkp = v[3*k + p];
+              const double vkq = v[3*k + q];
+              v[3*k + p] = c*vkp - s*vkq;
+              v[3*k + q] = s*vkp + c*vkq;
+            }
+          }
+      }
+
+      const double det = v[0]*(v[4]*v[8] - v[5]*v[7])
+                       - v[1]*(v[3]*v[8] - v[5]*v[6])
+                       + v[2]*(v[3]*v[7] - v[4]*v[6]);
+      if (det < 0)
+        for (int k = 0; k < 3; k++)
+          v[3*k + 2] = -v[3*k + 2];
+    }
+
+    // m v and m^T v
+    inline ThreeVector apply(const double m[9], const ThreeVector& v) {
+      return ThreeVector(m[0]*v[0] + m[1]*v[1] + m[2]*v[2],
+                         m[3]*v[0] + m[4]*v[1] + m[5]*v[2],
+                         m[6]*v[0] + m[7]*v[1] + m[8]*v[2]);
+    }
+
+    inline ThreeVector applyTransposed(const double m[9],
+                                       const ThreeVector& v) {
+      return ThreeVector(m[0]*v[0] + m[3]*v[1] + m[6]*v[2],
+                         m[1]*v[0] + m[4]*v[1] + m[7]*v[2],
+                         m[2]*v[0] + m[5]*v[1] + m[8]*v[2]);
+    }
+
+  } // namespace
+
+  RigidBodies::RigidBodies() : renormalizeInterval(100), updates(0) {
+    siteStart.push_back(0);
+  }
+
+  int RigidBodies::addBody(const std::vector<Particle>& sites,
+                           const ThreeVector& position,
+                           const Quaternion& orientation,
+                           const ThreeVector& velocity,
+                           const ThreeVector& angularVelocity,
+                           const double* inertia) {
+    const int n = sites.size();
+
+    // the force laws give no dv to massless targets, so the impulses on
+    // such a site would be lost
+    for (int i = 0; i < n; i++)
+      if (sites[i].mass < 0 || (sites[i].mass == 0 && sites[i].charge != 0))
+        throw std::invalid_argument("RigidBodies: charged sites need a"
+                                    " positive mass");
+
+    double m = 0;
+    ThreeVector center(0, 0, 0);
+    for (int i = 0; i < n; i++) {
+      m += sites[i].mass;
+      center += sites[i].mass*sites[i].position;
+    }
+    if (m > 0) center /= m;
+
+    double a[9];
+    if (inertia) {
+      for (int k = 0; k < 9; k++)
+        a[k] = inertia[k];
+    } else {
+      for (int k = 0; k < 9; k++)
+        a[k] = 0;
+      for (int i = 0; i < n; i++) {
+        const ThreeVector r = sites[i].position - center;
+        const double r2 = r*r;
+        for (int j = 0; j < 3; j++)
+          for (int k = 0; k < 3; k++)
+            a[3*j + k] += sites[i].mass*((j == k ? r2 : 0) - r[j]*r[k]);
+      }
+    }
+
+    // the body frame is the principal axes frame of the sites
+    double v[9];
+    diagonalize(a, v);
+    for (int i = 0; i < n; i++) {
+      const ThreeVector s = applyTransposed(v, sites[i].position - center);
+      sx.push_back(s[0]);
+      sy.push_back(s[1]);
+      sz.push_back(s[2]);
+      siteMass.push_back(sites[i].mass);
+      siteCharge.push_back(sites[i].charge);
+    }
+    siteStart.push_back(sx.size());
+
+    Quaternion q = orientation*rotationQuaternion(v);
+    q /= q.length();
+
+    double r[9];
+    rotationMatrix(q[0], q[1], q[2], q[3], r);
+    const ThreeVector w = applyTransposed(r, angularVelocity);
+
+    x.push_back(position[0]);
+    y.push_back(position[1]);
+    z.push_back(position[2]);
+    vx.push_back(velocity[0]);
+    vy.push_back(velocity[1]);
+    vz.push_back(velocity[2]);
+    q0.push_back(q[0]);
+    q1.push_back(q[1]);
+    q2.push_back(q[2]);
+    q3.push_back(q[3]);
+    ix.push_back(a[0]);
+    iy.push_back(a[4]);
+    iz.push_back(a[8]);
+    lx.push_back(a[0]*w[0]);
+    ly.push_back(a[4]*w[1]);
+    lz.push_back(a[8]*w[2]);
+    mass.push_back(m);
+    dvx.push_back(0);
+    dvy.push_back(0);
+    dvz.push_back(0);
+    dlx.push_back(0);
+    dly.push_back(0);
+    dlz.push_back(0);
+    return mass.size() - 1;
+  }
+
+  void RigidBodies::sites(ParticleArray& out) const {
+    out.resize(siteCount());
+    const int n = size();
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int b = 0; b < n; b++) {
+      double m[9];
+      rotationMatrix(q0[b], q1[b], q2[b], q3[b], m);
+      const ThreeVector w = angularVelocity(b);
+
+      for (int i = siteStart[b]; i < siteStart[b+1]; i++) {
+        const ThreeVector r = apply(m, ThreeVector(sx[i], sy[i], sz[i]));
+        const ThreeVector u = cross(w, r);
+        out.x[i] = x[b] + r[0];
+        out.y[i] = y[b] + r[1];
+        out.z[i] = z[b] + r[2];
+        out.vx[i] = vx[b] + u[0];
+        out.vy[i] = vy[b] + u[1];
+        out.vz[i] = vz[b] + u[2];
+        out.dvx[i] = 0;
+        out.dvy[i] = 0;
+        out.dvz[i] = 0;
+        out.mass[i] = siteMass[i];
+        out.charge[i] = siteCharge[i];
+      }
+    }
+  }
+
+  RigidBodies& RigidBodies::applyImpulses(const ParticleArray& s) {
+    const int n = size();
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int b = 0; b < n; b++) {
+      ThreeVector p(0, 0, 0), l(0, 0, 0);
+      for (int i = siteStart[b]; i < siteStart[b+1]; i++) {
+        const ThreeVector j = s.mass[i]*ThreeVector(s.dvx[i], s.dvy[i],
+                                                    s.dvz[i]);
+        const ThreeVector r(s.x[i] - x[b], s.y[i] - y[b], s.z[i] - z[b]);
+        p += j;
+        l += cross(r, j);
+      }
+      if (mass[b] > 0) p /= mass[b];
+
+      double m[9];
+      rotationMatrix(q0[b], q1[b], q2[b], q3[b], m);
+      l = applyTransposed(m, l);
+
+      dvx[b] += p[0];
+      dvy[b] += p[1];
+      dvz[b] += p[2];
+      dlx[b] += l[0];
+      dly[b] += l[1];
+      dlz[b] += l[2];
+    }
+    return *this;
+  }
+
+  RigidBodies& RigidBodies::update(const double dt) {
+    const int n = size();
+    if (n == 0) return *this;
+
+    #pragma omp parallel for
+    for (int b = 0; b < n; b++) {
+      vx[b] += dvx[b];
+      vy[b] += dvy[b];
+      vz[b] += dvz[b];
+      x[b] += vx[b]*dt;
+      y[b] += vy[b]*dt;
+      z[b] += vz[b]*dt;
+      lx[b] += dlx[b];
+      ly[b] += dly[b];
+      lz[b] += dlz[b];
+      dvx[b] = dvy[b] = dvz[b] = 0;
+      dlx[b] = dly[b] = dlz[b] = 0;
+    }
+
+    Kernels::table().rotateBodies(n, dt, &ix[0], &iy[0], &iz[0], &q0[0],
+                                  &q1[0], &q2[0], &q3[0], &lx[0], &ly[0],
+                                  &lz[0]);
+
+    if (renormalizeInterval > 0 && ++updates >= renormalizeInterval) {
+      renormalize();
+      updates = 0;
+    }
+    return *this;
+  }
+
+  RigidBodies& RigidBodies::renormalize() {
+    const int n = size();
+
+    #pragma omp parallel for simd
+    for (int b = 0; b < n; b++) {
+      const double s = 1/std::sqrt(q0[b]*q0[b] + q1[b]*q1[b] + q2[b]*q2[b]
+                                   + q3[b]*q3[b]);
+      q0[b] *= s;
+      q1[b] *= s;
+      q2[b] *= s;
+      q3[b] *= s;
+    }
+    return *this;
+  }
+
+  Quaternion RigidBodies::orientation(const int b) const {
+    return Quaternion(q0[b], q1[b], q2[b], q3[b]);
+  }
+
+  ThreeVector RigidBodies::angularMomentum(const int b) const {
+    double m[9];
+    rotationMatrix(q0[b], q1[b], q2[b], q3[b], m);
+    return apply(m, ThreeVector(lx[b], ly[b], lz[b]));
+  }
+
+  ThreeVector RigidBodies::angularVelocity(const int b) const {
+    // zero moments (linear bodies) do not rotate about that axis
+    const ThreeVector w(ix[b] > 0 ? lx[b]/ix[b] : 0,
+                        iy[b] > 0 ? ly[b]/iy[b] : 0,
+                        iz[b] > 0 ? lz[b]/iz[b] : 0);
+    double m[9];
+    rotationMatrix(q0[b], q1[b], q2[b], q3[b], m);
+    return apply(m, w);
+  }
+
+  double RigidBodies::kineticEnergy() const {
+    const int n = size();
+    double e = 0;
+    for (int b = 0; b < n; b++) {
+      e += 0.5*mass[b]*(vx[b]*vx[b] + vy[b]*vy[b] + vz[b]*vz[b]);
+      if (ix[b] > 0) e += 0.5*lx[b]*lx[b]/ix[b];
+      if (iy[b] > 0) e += 0.5*ly[b]*ly[b]/iy[b];
+      if (iz[b] > 0) e += 0.5*lz[b]*lz[b]/iz[b];
+    }
+    return e;
+  }
+
+} // namespace bps
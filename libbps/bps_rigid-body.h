@@ -0,0 +1,115 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_RIGID_BODY_H
+#define BPS_RIGID_BODY_H
+
+#include <vector>
+
+#include "bps_3-vector.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_quaternion.h"
+
+namespace bps {
+
+  // Rigid bodies made of point sites, stored as structure of arrays. Each
+  // body is kept in its principal axes frame: the orientation q maps body
+  // to world coordinates (v -> q v q*), the angular momentum is stored in
+  // body coordinates.
+  //
+  // A step works like for ParticleArray: sites() gives the sites in world
+  // coordinates, any force law fills their dv, applyImpulses() turns those
+  // into momentum and angular momentum of the bodies, and update() moves
+  // the bodies. The free rotation is a symmetric splitting into rotations
+  // about the principal axes, each exactly orthogonal, so kinetic energy
+  // and angular momentum are conserved up to rounding and the quaternion
+  // norm changes only by rounding; it is reset every few hundred steps.
+  class RigidBodies {
+    public:
+      // bodies
+      std::vector<double> x, y, z;
+      std::vector<double> vx, vy, vz;
+      std::vector<double> q0, q1, q2, q3;
+      std::vector<double> lx, ly, lz;
+      std::vector<double> ix, iy, iz;  // principal moments of inertia
+      std::vector<double> mass;
+
+      // impulses collected by applyImpulses (velocity and body-frame
+      // angular momentum increments), used up by update
+      std::vector<double> dvx, dvy, dvz;
+      std::vector<double> dlx, dly, dlz;
+
+      // sites of body b are [siteStart[b], siteStart[b+1]); positions in
+      // the principal frame relative to the center of mass
+      std::vector<int> siteStart;
+      std::vector<double> sx, sy, sz;
+      std::vector<double> siteMass, siteCharge;
+
+    protected:
+      int renormalizeInterval;
+      int updates;
+
+    public:
+      RigidBodies();
+
+      inline int size() const { return mass.size(); }
+      inline int siteCount() const { return sx.size(); }
+
+      // Adds a body made of sites (position relative to any body origin,
+      // mass and charge; the velocity is ignored) and returns its index.
+      // The center of mass is placed at position. The inertia tensor
+      // (row-major, about the center of mass, in the frame of the sites)
+      // is computed from the site masses unless given. Charged sites need
+      // a positive mass (std::invalid_argument otherwise), since impulses
+      // are collected as m dv.
+      int addBody(const std::vector<Particle>& sites,
+                  const ThreeVector& position,
+                  const Quaternion& orientation = Quaternion(1, 0, 0, 0),
+                  const ThreeVector& velocity = ThreeVector(0, 0, 0),
+                  const ThreeVector& angularVelocity = ThreeVector(0, 0, 0),
+                  const double* inertia = 0);
+
+      // sites in world coordinates with velocities v + w x r and zero dv
+      void sites(ParticleArray& out) const;
+
+      // collects the impulses m dv of the sites returned by sites()
+      RigidBodies& applyImpulses(const ParticleArray& s);
+
+      // applies the collected impulses and advances the bodies by dt
+      RigidBodies& update(const double dt);
+
+      // rescales all orientations to unit norm
+      RigidBodies& renormalize();
+      inline RigidBodies& setRenormalizeInterval(const int interval) {
+        renormalizeInterval = interval;
+        return *this;
+      }
+
+      Quaternion orientation(const int b) const;
+
+      // in world coordinates
+      ThreeVector angularMomentum(const int b) const;
+      ThreeVector angularVelocity(const int b) const;
+
+      double kineticEnergy() const;
+  };
+
+} // namespace bps
+
+#endif // BPS_RIGID_BODY_H
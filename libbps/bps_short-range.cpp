@@ -0,0 +1,81 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+
+namespace bps {
+
+  ScreenedColoumbForce::ScreenedColoumbForce(const double _debyeLength,
+                                             const double cutoff,
+                                             const double skin,
+                                             const PeriodicBox& box)
+          : debyeLength(_debyeLength), verlet(cutoff, skin, box) {}
+
+  ScreenedColoumbForce& ScreenedColoumbForce::reconfigure(
+          const double _debyeLength, const double cutoff, const double skin,
+          const PeriodicBox& box) {
+    debyeLength = _debyeLength;
+    verlet.reconfigure(cutoff, skin, box);
+    return *this;
+  }
+
+  ScreenedColoumbForce& ScreenedColoumbForce::apply(
+          std::vector<Particle>& particles, const double dt) {
+    verlet.update(particles);
+
+    const double k = 1/(4*M_PI*BPS_CONST_VACUUM_PERMITTIVITY);
+    const double cutoff_square = verlet.getCutoff()*verlet.getCutoff();
+    const PeriodicBox& box = verlet.getBox();
+    const int n = particles.size();
+
+    for (int i = 0; i < n; i++) {
+      Particle& p = particles[i];
+      if (p.charge == 0) continue;
+
+      for (int m = verlet.neighbourBegin(i); m < verlet.neighbourEnd(i); m++) {
+        Particle& q = particles[verlet.neighbour(m)];
+        if (q.charge == 0) continue;
+
+        double r[3];
+        for (int d = 0; d < 3; d++)
+          r[d] = box.minimumImage(q.position[d] - p.position[d], d);
+        const double l_square = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+        if (l_square >= cutoff_square) continue;
+
+        // Newton's third law: p and q get opposite impulses
+        const double l = std::sqrt(l_square);
+        const double f = dt*k*p.charge*q.charge
+                         *std::exp(-l/debyeLength)*(1 + l/debyeLength)
+                         /(l_square*l);
+        for (int d = 0; d < 3; d++) {
+          if (q.mass != 0) q.dv[d] += f/q.mass*r[d];
+          if (p.mass != 0) p.dv[d] -= f/p.mass*r[d];
+        }
+      }
+    }
+    return *this;
+  }
+
+} // namespace bps
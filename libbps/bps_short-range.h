@@ -0,0 +1,66 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_SHORT_RANGE_H
+#define BPS_SHORT_RANGE_H
+
+#include <vector>
+
+#include "bps_neighbour-list.h"
+#include "bps_particle.h"
+#include "bps_periodic-box.h"
+
+namespace bps {
+
+  // Screened (Yukawa) Coloumb interaction of all particle pairs closer than
+  // cutoff. Pairs are taken from a Verlet list, so one call costs O(N) as
+  // long as the density stays bounded. The result is the same as calling
+  // Particle::screenedColoumbForce for every pair within the cutoff (using
+  // nearest images if a periodic box is given).
+  class ScreenedColoumbForce {
+    protected:
+      double debyeLength;
+      VerletList verlet;
+
+    public:
+      ScreenedColoumbForce(const double _debyeLength, const double cutoff,
+                           const double skin,
+                           const PeriodicBox& box = PeriodicBox());
+
+      // new parameters, keeping the buffers of the Verlet list
+      ScreenedColoumbForce& reconfigure(const double _debyeLength,
+                                        const double cutoff,
+                                        const double skin,
+                                        const PeriodicBox& box = PeriodicBox());
+
+      ScreenedColoumbForce& apply(std::vector<Particle>& particles,
+                                  const double dt);
+
+      // rebuilds the Verlet list in the next apply
+      inline ScreenedColoumbForce& invalidate() {
+        verlet.invalidate();
+        return *this;
+      }
+
+      inline double getDebyeLength() const { return debyeLength; }
+      inline const VerletList& neighbourList() const { return verlet; }
+  };
+
+} // namespace bps
+
+#endif // BPS_SHORT_RANGE_H
@@ -0,0 +1,155 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "bps_particle-array.h"
+#include "bps_step-pipeline.h"
+#include "bps_task-graph.h"
+
+namespace bps {
+
+  StepPipeline::StepPipeline(ParticleArray& _particles, const double _dt,
+                             const int _forces, const int tiles)
+          : particles(_particles), dt(_dt), forces(_forces),
+            tileCount(tiles), step(0), prepareHook(0), prepareData(0),
+            diagnosticsObserver(0), diagnosticsData(0), outputObserver(0),
+            outputData(0) {}
+
+  StepPipeline& StepPipeline::setPrepare(Hook hook, void* data) {
+    prepareHook = hook;
+    prepareData = data;
+    return *this;
+  }
+
+  StepPipeline& StepPipeline::setDiagnostics(Observer observer, void* data) {
+    diagnosticsObserver = observer;
+    diagnosticsData = data;
+    return *this;
+  }
+
+  StepPipeline& StepPipeline::setOutput(Observer observer, void* data) {
+    outputObserver = observer;
+    outputData = data;
+    return *this;
+  }
+
+  StepPipeline& StepPipeline::run(const int steps, const int threads) {
+    const int n = particles.size();
+    const int count = tileCount > 0 ? tileCount : std::max(1, (n + 63)/64);
+
+    tiles.resize(count);
+    for (int i = 0; i < count; i++) {
+      tiles[i].pipeline = this;
+      tiles[i].begin = static_cast<long>(n)*i/count;
+      tiles[i].end = static_cast<long>(n)*(i + 1)/count;
+    }
+
+    graph = TaskGraph();
+    const int prepareTask = graph.add("prepare", prepare, this);
+    const int kickDriftTask = graph.add("kick-drift", kickDrift, this);
+    const int snapshotTask = graph.add("snapshot", snapshot, this);
+    const int diagnosticsTask = graph.add("diagnostics", diagnostics, this);
+    const int outputTask = graph.add("output", output, this);
+
+    graph.depend(prepareTask, kickDriftTask, 1);
+    // the hook may change the particles the snapshot of the previous step
+    // copies
+    graph.depend(prepareTask, snapshotTask, 1);
+    for (int i = 0; i < count; i++) {
+      std::ostringstream name;
+      name << "forces " << i;
+      const int forceTask = graph.add(name.str(), force, &tiles[i]);
+      graph.depend(forceTask, prepareTask);
+      graph.depend(kickDriftTask, forceTask);
+    }
+    // the snapshot of the previous step must be taken before the drift
+    graph.depend(kickDriftTask, snapshotTask, 1);
+    graph.depend(snapshotTask, kickDriftTask);
+    // the buffer of step k is reused in step k + 2
+    graph.depend(snapshotTask, diagnosticsTask, 2);
+    graph.depend(snapshotTask, outputTask, 2);
+    graph.depend(diagnosticsTask, snapshotTask);
+    graph.depend(outputTask, snapshotTask);
+
+    graph.run(steps, threads);
+    step += steps;
+    return *this;
+  }
+
+  void StepPipeline::prepare(void* data, const int iteration) {
+    StepPipeline* p = static_cast<StepPipeline*>(data);
+    if (p->prepareHook)
+      p->prepareHook(p->particles, p->step + iteration, p->prepareData);
+  }
+
+  void StepPipeline::force(void* data, const int) {
+    const Tile* t = static_cast<Tile*>(data);
+    ParticleArray& a = t->pipeline->particles;
+
+    std::fill(a.dvx.begin() + t->begin, a.dvx.begin() + t->end, 0.0);
+    std::fill(a.dvy.begin() + t->begin, a.dvy.begin() + t->end, 0.0);
+    std::fill(a.dvz.begin() + t->begin, a.dvz.begin() + t->end, 0.0);
+    if (t->pipeline->forces & Gravitational)
+      a.gravitationalForces(t->pipeline->dt, t->begin, t->end);
+    if (t->pipeline->forces & Coloumb)
+      a.coloumbForces(t->pipeline->dt, t->begin, t->end);
+  }
+
+  void StepPipeline::kickDrift(void* data, const int) {
+    StepPipeline* p = static_cast<StepPipeline*>(data);
+    p->particles.updatePositions(p->dt);
+  }
+
+  void StepPipeline::snapshot(void* data, const int iteration) {
+    StepPipeline* p = static_cast<StepPipeline*>(data);
+    if (!p->diagnosticsObserver && !p->outputObserver) return;
+
+    const ParticleArray& a = p->particles;
+    ParticleArray& s = p->snapshots[iteration % 2];
+    s.x = a.x;
+    s.y = a.y;
+    s.z = a.z;
+    s.vx = a.vx;
+    s.vy = a.vy;
+    s.vz = a.vz;
+    s.mass = a.mass;
+    s.charge = a.charge;
+    // the next step's forces are writing dv meanwhile
+    s.dvx.assign(a.size(), 0);
+    s.dvy.assign(a.size(), 0);
+    s.dvz.assign(a.size(), 0);
+  }
+
+  void StepPipeline::diagnostics(void* data, const int iteration) {
+    StepPipeline* p = static_cast<StepPipeline*>(data);
+    if (p->diagnosticsObserver)
+      p->diagnosticsObserver(p->snapshots[iteration % 2],
+                             p->step + iteration + 1, p->diagnosticsData);
+  }
+
+  void StepPipeline::output(void* data, const int iteration) {
+    StepPipeline* p = static_cast<StepPipeline*>(data);
+    if (p->outputObserver)
+      p->outputObserver(p->snapshots[iteration % 2],
+                        p->step + iteration + 1, p->outputData);
+  }
+
+} // namespace bps
@@ -0,0 +1,102 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_STEP_PIPELINE_H
+#define BPS_STEP_PIPELINE_H
+
+#include <vector>
+
+#include "bps_particle-array.h"
+#include "bps_task-graph.h"
+
+namespace bps {
+
+  // Time steps of a ParticleArray as a TaskGraph with the stages
+  //
+  //   prepare      optional hook before the forces, e.g. a tree build
+  //   forces i     all-pairs forces on one tile of the particles
+  //   kick-drift   ParticleArray::updatePositions
+  //   snapshot     copies the particles (without dv) into one of two
+  //                buffers
+  //   diagnostics  optional observer of the snapshot
+  //   output       optional observer of the snapshot, e.g. file output
+  //
+  // Diagnostics and output of step k read the snapshot, so they overlap
+  // with the prepare and force stages of step k + 1 (and k + 2). The
+  // results are those of the serial sequence clearDv, gravitationalForces
+  // and/or coloumbForces, updatePositions.
+  class StepPipeline {
+    public:
+      enum Force { Gravitational = 1, Coloumb = 2 };
+
+      typedef void (*Hook)(ParticleArray& particles, const int step,
+                           void* data);
+      typedef void (*Observer)(const ParticleArray& snapshot,
+                               const int step, void* data);
+
+    protected:
+      struct Tile {
+        StepPipeline* pipeline;
+        int begin, end;
+      };
+
+      ParticleArray& particles;
+      double dt;
+      int forces;
+      int tileCount;
+      int step;  // of the first iteration of the current run
+
+      Hook prepareHook;
+      void* prepareData;
+      Observer diagnosticsObserver;
+      void* diagnosticsData;
+      Observer outputObserver;
+      void* outputData;
+
+      ParticleArray snapshots[2];
+      std::vector<Tile> tiles;
+      TaskGraph graph;
+
+      static void prepare(void* data, const int iteration);
+      static void force(void* data, const int iteration);
+      static void kickDrift(void* data, const int iteration);
+      static void snapshot(void* data, const int iteration);
+      static void diagnostics(void* data, const int iteration);
+      static void output(void* data, const int iteration);
+
+    public:
+      // tiles = 0 chooses about 64 particles per tile
+      StepPipeline(ParticleArray& _particles, const double _dt,
+                   const int _forces = Gravitational, const int tiles = 0);
+
+      StepPipeline& setPrepare(Hook hook, void* data = 0);
+      StepPipeline& setDiagnostics(Observer observer, void* data = 0);
+      StepPipeline& setOutput(Observer observer, void* data = 0);
+
+      // advances the particles by the given number of steps
+      StepPipeline& run(const int steps, const int threads = 0);
+
+      inline int getStep() const { return step; }
+
+      // stage timing of the last run
+      inline const TaskGraph& taskGraph() const { return graph; }
+  };
+
+} // namespace bps
+
+#endif // BPS_STEP_PIPELINE_H
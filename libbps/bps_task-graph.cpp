@@ -0,0 +1,272 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bps_task-graph.h"
+
+namespace bps {
+
+  namespace {
+
+    double now() {
+      timeval t;
+      gettimeofday(&t, 0);
+      return t.tv_sec + 1e-6*t.tv_usec;
+    }
+
+  } // namespace
+
+  TaskGraph::TaskGraph() : iterations(0), completed(0), runStart(0),
+                           runFinish(0) {}
+
+  int TaskGraph::add(const std::string& name, Function function, void* data) {
+    Task t;
+    t.name = name;
+    t.function = function;
+    t.data = data;
+    tasks.push_back(t);
+    return tasks.size() - 1;
+  }
+
+  TaskGraph& TaskGraph::depend(const int task, const int prerequisite,
+                               const int lag) {
+    const int n = tasks.size();
+    if (task < 0 || task >= n || prerequisite < 0 || prerequisite >= n)
+      throw std::invalid_argument("TaskGraph: no such task");
+    if (lag < 0)
+      throw std::invalid_argument("TaskGraph: negative lag");
+
+    Dependency d;
+    d.lag = lag;
+    d.task = prerequisite;
+    tasks[task].prerequisites.push_back(d);
+    d.task = task;
+    tasks[prerequisite].successors.push_back(d);
+    return *this;
+  }
+
+  void TaskGraph::checkCycles() const {
+    const int n = tasks.size();
+
+    // Kahn's algorithm on the dependencies with lag 0: tasks without
+    // prerequisites are removed until none are left, or only a cycle
+    std::vector<int> count(n, 0);
+    for (int t = 0; t < n; t++)
+      for (unsigned int p = 0; p < tasks[t].prerequisites.size(); p++)
+        if (tasks[t].prerequisites[p].lag == 0) count[t]++;
+
+    std::vector<int> free;
+    for (int t = 0; t < n; t++)
+      if (count[t] == 0) free.push_back(t);
+
+    int removed = 0;
+    while (!free.empty()) {
+      const int t = free.back();
+      free.pop_back();
+      removed++;
+      for (unsigned int s = 0; s < tasks[t].successors.size(); s++) {
+        const Dependency& d = tasks[t].successors[s];
+        if (d.lag == 0 && --count[d.task] == 0) free.push_back(d.task);
+      }
+    }
+
+    if (removed < n)
+      throw std::invalid_argument(
+          "TaskGraph: the dependencies with lag 0 form a cycle");
+  }
+
+  TaskGraph& TaskGraph::run(const int _iterations, const int threads) {
+    checkCycles();
+
+    const int n = tasks.size();
+    iterations = _iterations;
+    pending.assign(iterations*n, 0);
+    start.assign(iterations*n, 0);
+    finish.assign(iterations*n, 0);
+    completion.assign(iterations*n, 0);
+    completed = 0;
+
+    std::vector<int> ready;
+    for (int k = 0; k < iterations; k++) {
+      for (int t = 0; t < n; t++) {
+        int count = k > 0 ? 1 : 0;
+        for (unsigned int p = 0; p < tasks[t].prerequisites.size(); p++)
+          if (k >= tasks[t].prerequisites[p].lag) count++;
+        pending[k*n + t] = count;
+        if (count == 0) ready.push_back(k*n + t);
+      }
+    }
+
+    runStart = now();
+#ifdef _OPENMP
+    const int count = threads > 0 ? threads : omp_get_max_threads();
+    #pragma omp parallel num_threads(count)
+    {
+      #pragma omp single
+      for (unsigned int i = 0; i < ready.size(); i++)
+        spawn(ready[i]);
+    }
+#else
+    (void)threads;
+    while (!ready.empty()) {
+      const int instance = ready.back();
+      ready.pop_back();
+      execute(instance, ready);
+    }
+#endif
+    runFinish = now();
+    return *this;
+  }
+
+  void TaskGraph::spawn(const int instance) {
+    #pragma omp task firstprivate(instance)
+    {
+      std::vector<int> ready;
+      execute(instance, ready);
+      for (unsigned int i = 0; i < ready.size(); i++)
+        spawn(ready[i]);
+    }
+  }
+
+  void TaskGraph::execute(const int instance, std::vector<int>& ready) {
+    const int n = tasks.size();
+    const int t = instance % n;
+    const int k = instance/n;
+    const Task& task = tasks[t];
+
+    start[instance] = now();
+    task.function(task.data, k);
+    finish[instance] = now();
+
+    int position;
+    #pragma omp atomic capture
+    position = completed++;
+    completion[position] = instance;
+
+    // make the results visible before the successors can be released
+    #pragma omp flush
+
+    for (unsigned int s = 0; s <= task.successors.size(); s++) {
+      // the last one is the next instance of this task
+      const int j = s < task.successors.size()
+                    ? (k + task.successors[s].lag)*n + task.successors[s].task
+                    : instance + n;
+      if (j >= iterations*n) continue;
+
+      int left;
+      #pragma omp atomic capture
+      left = --pending[j];
+      if (left == 0) ready.push_back(j);
+    }
+  }
+
+  double TaskGraph::wallTime() const {
+    return runFinish - runStart;
+  }
+
+  double TaskGraph::busyTime(const int task) const {
+    const int n = tasks.size();
+    double sum = 0;
+    for (int k = 0; k < iterations; k++)
+      sum += finish[k*n + task] - start[k*n + task];
+    return sum;
+  }
+
+  void TaskGraph::criticalPath(std::vector<double>& share) const {
+    const int n = tasks.size();
+    const int m = iterations*n;
+    share.assign(n + 1, 0);  // the last entry is the total
+    if (m == 0) return;
+
+    // an instance finishes after its prerequisites, so the completion
+    // order is a topological order
+    std::vector<double> longest(m);  // longest chain ending with i
+    std::vector<int> previous(m, -1);
+    for (int o = 0; o < completed; o++) {
+      const int i = completion[o];
+      const int t = i % n;
+      const int k = i/n;
+
+      double before = 0;
+      if (k > 0) {
+        before = longest[i - n];
+        previous[i] = i - n;
+      }
+      for (unsigned int p = 0; p < tasks[t].prerequisites.size(); p++) {
+        const Dependency& d = tasks[t].prerequisites[p];
+        if (k < d.lag) continue;
+        const int j = (k - d.lag)*n + d.task;
+        if (longest[j] > before) {
+          before = longest[j];
+          previous[i] = j;
+        }
+      }
+      longest[i] = before + finish[i] - start[i];
+    }
+
+    int last = std::max_element(longest.begin(), longest.end())
+               - longest.begin();
+    share[n] = longest[last];
+    for (int i = last; i >= 0; i = previous[i])
+      share[i % n] += finish[i] - start[i];
+  }
+
+  double TaskGraph::criticalPath() const {
+    std::vector<double> share;
+    criticalPath(share);
+    return share.back();
+  }
+
+  double TaskGraph::criticalTime(const int task) const {
+    std::vector<double> share;
+    criticalPath(share);
+    return share[task];
+  }
+
+  void TaskGraph::report(std::ostream& os) const {
+    std::vector<double> share;
+    criticalPath(share);
+
+    const int n = tasks.size();
+    unsigned int width = 4;
+    for (int t = 0; t < n; t++)
+      width = std::max(width, static_cast<unsigned int>(tasks[t].name.size()));
+
+    os << std::left << std::setw(width) << "task" << std::right
+       << std::setw(14) << "busy [s]" << std::setw(14) << "critical [s]"
+       << std::endl;
+    for (int t = 0; t < n; t++)
+      os << std::left << std::setw(width) << tasks[t].name << std::right
+         << std::setw(14) << busyTime(t) << std::setw(14) << share[t]
+         << std::endl;
+    os << "wall time " << wallTime() << " s, critical path " << share[n]
+       << " s, " << iterations << " iterations" << std::endl;
+  }
+
+} // namespace bps
@@ -0,0 +1,109 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BPS_TASK_GRAPH_H
+#define BPS_TASK_GRAPH_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bps {
+
+  // Tasks that are run repeatedly (e.g. once per time step) in the order
+  // given by their dependencies. Instance k of a task waits for instance
+  // k - lag of each of its prerequisites and for its own instance k - 1;
+  // everything else may overlap, also across iterations. With lag 1, for
+  // example, diagnostics of step k can run while the forces of step k + 1
+  // are computed. The dependencies with lag 0 must not form a cycle, which
+  // run checks (std::invalid_argument).
+  //
+  // The tasks run as OpenMP tasks; without OpenMP they run one after
+  // another in a valid order. Parallel loops inside a task run serially.
+  class TaskGraph {
+    public:
+      typedef void (*Function)(void* data, const int iteration);
+
+    protected:
+      struct Dependency {
+        int task;
+        int lag;
+      };
+
+      struct Task {
+        std::string name;
+        Function function;
+        void* data;
+        std::vector<Dependency> prerequisites;
+        std::vector<Dependency> successors;
+      };
+
+      std::vector<Task> tasks;
+
+      // state and timing of the last run, per instance (iteration-major)
+      int iterations;
+      std::vector<int> pending;
+      std::vector<double> start, finish;
+      std::vector<int> completion;  // instances in the order they finished
+      int completed;
+      double runStart, runFinish;
+
+      void checkCycles() const;
+      void execute(const int instance, std::vector<int>& ready);
+      void spawn(const int instance);
+
+    public:
+      TaskGraph();
+
+      // adds a task and returns its id
+      int add(const std::string& name, Function function, void* data = 0);
+
+      // instance k of task waits for instance k - lag of prerequisite;
+      // both must have been added and lag must not be negative
+      // (std::invalid_argument)
+      TaskGraph& depend(const int task, const int prerequisite,
+                        const int lag = 0);
+
+      // runs every task the given number of times on up to threads
+      // threads (0 uses the OpenMP default)
+      TaskGraph& run(const int _iterations = 1, const int threads = 0);
+
+      inline int size() const { return tasks.size(); }
+      inline const std::string& name(const int task) const {
+        return tasks[task].name;
+      }
+
+      // timing of the last run (seconds)
+      double wallTime() const;
+      double busyTime(const int task) const;
+
+      // longest chain of dependent instances, i.e. the run time with
+      // unlimited threads, and the time each task contributes to it
+      double criticalPath() const;
+      double criticalTime(const int task) const;
+
+      // table of the above
+      void report(std::ostream& os) const;
+
+    protected:
+      void criticalPath(std::vector<double>& share) const;
+  };
+
+} // namespace bps
+
+#endif // BPS_TASK_GRAPH_H
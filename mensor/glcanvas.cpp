@@ -16,6 +16,13 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cmath>
+
+#include <QMouseEvent>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include "bps_particle-array.h"
 #include "glcanvas.h"
 #include "glcanvas.moc"
 
@@ -26,43 +33,48 @@ GLCanvas::~GLCanvas() {
   makeCurrent();
 }
 
+void GLCanvas::setParticles(const bps::ParticleArray& particles) {
+  renderer.setParticles(particles);
+  update();
+}
+
 void GLCanvas::initializeGL() {
-  glClearColor(0.5, 0.5, 0.5, 0.0);
-  glEnable(GL_DEPTH_TEST);
+  renderer.initialize();
 }
 
 void GLCanvas::resizeGL(int width, int height) {
-
-        int side = qMin(width, height);
-        glViewport((width - side) / 2, (height - side) / 2, side, side);
-
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-0.5, +0.5, +0.5, -0.5, 4.0, 15.0);
-        glMatrixMode(GL_MODELVIEW);
+  renderer.resize(width, height);
 }
 
 void GLCanvas::paintGL() {
+  // the refinement budget was used up, continue in the next frame
+  if (!renderer.paint(camera))
+    QTimer::singleShot(0, this, SLOT(updateGL()));
+}
 
+void GLCanvas::mousePressEvent(QMouseEvent* event) {
+  lastPos = event->pos();
+}
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glLoadIdentity();
-        glTranslated(0.0, 0.0, -10.0);
-        glRotated(1. / 16.0, 1.0, 0.0, 0.0);
-        glRotated(1. / 16.0, 0.0, 1.0, 0.0);
-        glRotated(1. / 16.0, 0.0, 0.0, 1.0);
-
-    glBegin (GL_QUADS);
-      glColor3f (0.0, 0.0, 0.0); glVertex3f (0.0, 0.0, 0.0);   /* unten */
-      glColor3f (1.0, 0.0, 0.0); glVertex3f (1.0, 0.0, 0.0);
-      glColor3f (1.0, 0.0, 1.0); glVertex3f (1.0, 0.0, 1.0);
-      glColor3f (0.0, 0.0, 1.0); glVertex3f (0.0, 0.0, 1.0);
-  
-      glColor3f (0.0, 1.0, 0.0); glVertex3f (0.0, 1.0, 0.0);   /* oben */
-      glColor3f (0.0, 1.0, 1.0); glVertex3f (0.0, 1.0, 1.0);
-      glColor3f (1.0, 1.0, 1.0); glVertex3f (1.0, 1.0, 1.0);
-      glColor3f (1.0, 1.0, 0.0); glVertex3f (1.0, 1.0, 0.0);
-    glEnd ();
-
+void GLCanvas::mouseMoveEvent(QMouseEvent* event) {
+  const int dx = event->x() - lastPos.x();
+  const int dy = event->y() - lastPos.y();
+  lastPos = event->pos();
+
+  if (event->buttons() & Qt::LeftButton) {
+    camera.xRot += 0.5 * dy;
+    camera.yRot += 0.5 * dx;
+  } else if (event->buttons() & Qt::RightButton) {
+    const double pixel = 1.0 / (camera.zoom * renderer.viewportSide());
+    camera.xPan += dx * pixel;
+    camera.yPan += dy * pixel;
+  } else {
+    return;
+  }
+  updateGL();
+}
 
+void GLCanvas::wheelEvent(QWheelEvent* event) {
+  camera.zoom *= std::pow(1.2, event->delta() / 120.0);
+  updateGL();
 }
@@ -20,7 +20,18 @@
 #define GLCANVAS_H
 
 #include <QGLWidget>
+#include <QPoint>
 
+#include "bps_particle-array.h"
+#include "octree_renderer.h"
+
+class QMouseEvent;
+class QWheelEvent;
+
+// Shows a particle snapshot. Only a level-of-detail cut through an octree
+// of the snapshot is drawn (see OctreeRenderer), so that zoomed out views
+// of many particles do not touch every particle in every frame. The left
+// mouse button rotates, the right one pans, the wheel zooms.
 class GLCanvas : public QGLWidget {
   Q_OBJECT
 
@@ -28,10 +39,21 @@ class GLCanvas : public QGLWidget {
     GLCanvas(QWidget* parent = 0);
     ~GLCanvas();
 
+    void setParticles(const bps::ParticleArray& particles);
+
   protected:
     void initializeGL();
     void resizeGL(int width, int height);
     void paintGL();
+
+    void mousePressEvent(QMouseEvent* event);
+    void mouseMoveEvent(QMouseEvent* event);
+    void wheelEvent(QWheelEvent* event);
+
+  private:
+    OctreeRenderer renderer;
+    OctreeRenderer::Camera camera;
+    QPoint lastPos;
 };
 
 #endif // GLCANVAS_H
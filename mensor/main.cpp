@@ -16,8 +16,12 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <iostream>
+
 #include <QApplication>
 
+#include "bps_checkpoint.h"
+#include "bps_particle-array.h"
 #include "main_window.h"
 
 int main(int argc, char *argv[])
@@ -25,6 +29,17 @@ int main(int argc, char *argv[])
   QApplication app(argc, argv);
   MainWindow mainWindow;
 
+  // mensor [checkpoint prefix] shows the latest checkpoint of a run
+  if (argc > 1) {
+    bps::ParticleArray particles;
+    bps::RunState state;
+    if (!bps::Checkpoint::restore(argv[1], particles, state)) {
+      std::cerr << argv[0] << ": cannot restore " << argv[1] << std::endl;
+      return 1;
+    }
+    mainWindow.setParticles(particles);
+  }
+
   mainWindow.show();
   return app.exec();
 }
@@ -26,3 +26,7 @@ MainWindow::MainWindow() : QMainWindow() {
 
 MainWindow::~MainWindow() {
 }
+
+void MainWindow::setParticles(const bps::ParticleArray& particles) {
+  glCanvas.setParticles(particles);
+}
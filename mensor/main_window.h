@@ -21,6 +21,7 @@
 
 #include <QMainWindow>
 
+#include "bps_particle-array.h"
 #include "glcanvas.h"
 #include "ui_main_window.h"
 
@@ -31,6 +32,8 @@ class MainWindow : public QMainWindow {
     MainWindow();
     ~MainWindow();
 
+    void setParticles(const bps::ParticleArray& particles);
+
   private:
     Ui::MainWindow gui;
     GLCanvas glCanvas;
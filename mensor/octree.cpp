@@ -0,0 +1,368 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "bps_particle-array.h"
+#include "octree.h"
+
+namespace {
+
+  // bits per coordinate of the Morton codes, i.e. the maximum depth
+  const int maxDepth = 21;
+
+  // moves bit k of v to bit 3k
+  unsigned long long spread(unsigned long long v) {
+    v &= 0x1fffffULL;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+  }
+
+  void chargeColor(double charge, unsigned char* c) {
+    if (charge > 0) {
+      c[0] = 230; c[1] = 80; c[2] = 60;
+    } else if (charge < 0) {
+      c[0] = 70; c[1] = 110; c[2] = 230;
+    } else {
+      c[0] = c[1] = c[2] = 220;
+    }
+  }
+
+}
+
+Octree::Octree(int _leafSize) : leafSize(_leafSize) {
+}
+
+void Octree::clear() {
+  nodes.clear();
+  points.clear();
+  colors.clear();
+}
+
+void Octree::build(const bps::ParticleArray& particles) {
+  clear();
+  const int n = particles.size();
+  if (n == 0) return;
+
+  const std::vector<double>* r[3] = {
+    &particles.x, &particles.y, &particles.z
+  };
+
+  // bounding cube
+  double center[3], half = 0;
+  for (int d = 0; d < 3; d++) {
+    const double lo = *std::min_element(r[d]->begin(), r[d]->end());
+    const double hi = *std::max_element(r[d]->begin(), r[d]->end());
+    center[d] = (lo + hi)/2;
+    half = std::max(half, (hi - lo)/2);
+  }
+  if (half == 0) half = 1;
+
+  // sort along the Morton curve
+  const double cells = 1 << maxDepth;
+  std::vector<std::pair<unsigned long long, int> > keys(n);
+  for (int i = 0; i < n; i++) {
+    unsigned long long code = 0;
+    for (int d = 0; d < 3; d++) {
+      const double u = ((*r[d])[i] - center[d] + half)/(2*half)*cells;
+      const unsigned long long cell = static_cast<unsigned long long>(
+          std::min(std::max(u, 0.0), cells - 1));
+      code |= spread(cell) << (2 - d);
+    }
+    keys[i] = std::make_pair(code, i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<unsigned long long> codes(n);
+  std::vector<float> weights(n);
+  points.resize(3*n);
+  colors.resize(3*n);
+  for (int k = 0; k < n; k++) {
+    const int i = keys[k].second;
+    codes[k] = keys[k].first;
+    for (int d = 0; d < 3; d++)
+      points[3*k + d] = (*r[d])[i];
+    chargeColor(particles.charge[i], &colors[3*k]);
+    weights[k] = particles.mass[i];
+  }
+  keys.clear();
+
+  Node root;
+  for (int d = 0; d < 3; d++)
+    root.center[d] = center[d];
+  root.halfSize = half;
+  root.parent = -1;
+  root.begin = 0;
+  root.end = n;
+  nodes.push_back(root);
+  split(0, codes, 0);
+
+  // children always follow their parents
+  for (int i = nodes.size() - 1; i >= 0; i--)
+    summarize(i, weights);
+}
+
+void Octree::split(int node, const std::vector<unsigned long long>& codes,
+                   int depth) {
+  const int begin = nodes[node].begin;
+  const int end = nodes[node].end;
+  nodes[node].firstChild = -1;
+  nodes[node].childCount = 0;
+  if (end - begin <= leafSize || depth == maxDepth) return;
+
+  // the codes of the node share their leading 3*depth bits
+  const int shift = 3*(maxDepth - 1 - depth);
+  const unsigned long long prefix = codes[begin] >> (shift + 3) << (shift + 3);
+  int bounds[9];
+  bounds[0] = begin;
+  for (int o = 1; o < 8; o++)
+    bounds[o] = std::lower_bound(codes.begin() + bounds[o-1],
+                                 codes.begin() + end,
+                                 prefix | (unsigned long long)o << shift)
+                - codes.begin();
+  bounds[8] = end;
+
+  const int first = nodes.size();
+  const float quarter = nodes[node].halfSize/2;
+  for (int o = 0; o < 8; o++) {
+    if (bounds[o] == bounds[o+1]) continue;
+
+    Node child;
+    for (int d = 0; d < 3; d++)
+      child.center[d] = nodes[node].center[d]
+                        + ((o >> (2 - d)) & 1 ? quarter : -quarter);
+    child.halfSize = quarter;
+    child.parent = node;
+    child.begin = bounds[o];
+    child.end = bounds[o+1];
+    nodes.push_back(child);
+  }
+  nodes[node].firstChild = first;
+  nodes[node].childCount = nodes.size() - first;
+
+  for (int c = first; c < first + nodes[node].childCount; c++)
+    split(c, codes, depth + 1);
+}
+
+void Octree::summarize(int node, const std::vector<float>& weights) {
+  Node& a = nodes[node];
+  double mass = 0, count = 0;
+  double weighted[3] = {0, 0, 0}, mean[3] = {0, 0, 0}, color[3] = {0, 0, 0};
+
+  if (a.firstChild < 0) {
+    for (int k = a.begin; k < a.end; k++)
+      for (int d = 0; d < 3; d++) {
+        weighted[d] += weights[k]*points[3*k + d];
+        mean[d] += points[3*k + d];
+        color[d] += colors[3*k + d];
+      }
+    for (int k = a.begin; k < a.end; k++)
+      mass += weights[k];
+    count = a.end - a.begin;
+  } else {
+    for (int c = a.firstChild; c < a.firstChild + a.childCount; c++) {
+      const Node& b = nodes[c];
+      const double m = b.end - b.begin;
+      for (int d = 0; d < 3; d++) {
+        weighted[d] += b.mass*b.centroid[d];
+        mean[d] += m*b.centroid[d];
+        color[d] += m*b.color[d];
+      }
+      mass += b.mass;
+      count += m;
+    }
+  }
+
+  // massless particles count equally
+  for (int d = 0; d < 3; d++) {
+    a.centroid[d] = mass > 0 ? weighted[d]/mass : mean[d]/count;
+    a.color[d] = static_cast<unsigned char>(color[d]/count + 0.5);
+  }
+  a.mass = mass;
+}
+
+void Octree::bounds(float center[3], float& radius) const {
+  for (int d = 0; d < 3; d++)
+    center[d] = isEmpty() ? 0 : nodes[0].center[d];
+  radius = isEmpty() ? 1 : nodes[0].halfSize*std::sqrt(3.0f);
+}
+
+OctreeCut::OctreeCut(double _tolerance, int _pointBudget, int _refineBudget)
+        : tree(0), points(0), converged(false), tolerance(_tolerance),
+          pointBudget(_pointBudget), refineBudget(_refineBudget) {
+}
+
+void OctreeCut::reset(const Octree& _tree) {
+  tree = &_tree;
+  state.assign(tree->nodes.size(), NotDrawn);
+  cut.clear();
+  leaves.clear();
+  points = 0;
+  converged = false;
+  if (tree->isEmpty()) return;
+
+  state[0] = InCut;
+  cut.push_back(0);
+  points = 1;
+}
+
+double OctreeCut::error(int node, const View& view, double scale) const {
+  const Octree::Node& a = tree->nodes[node];
+  const double* m = view.modelview;
+  const double x = m[0]*a.center[0] + m[4]*a.center[1] + m[8]*a.center[2]
+                   + m[12];
+  const double y = m[1]*a.center[0] + m[5]*a.center[1] + m[9]*a.center[2]
+                   + m[13];
+  const double r = std::sqrt(3.0)*a.halfSize*scale;
+  if (std::fabs(x) - r > view.extent || std::fabs(y) - r > view.extent)
+    return 0;
+
+  // edge length of the cube in pixels
+  return a.halfSize*scale*view.pixels/view.extent;
+}
+
+bool OctreeCut::coarsen(const View& view, double scale) {
+  std::vector<int> added;
+
+  for (unsigned i = 0; i < leaves.size(); i++) {
+    const int leaf = leaves[i];
+    if (error(leaf, view, scale) > tolerance/2) continue;
+    state[leaf] = InCut;
+    points -= tree->count(leaf) - 1;
+    added.push_back(leaf);
+  }
+
+  // siblings that are all drawn as representatives merge into the parent
+  const int n = cut.size();
+  for (int i = 0; i < n + (int)added.size(); i++) {
+    const int node = i < n ? cut[i] : added[i - n];
+    const int parent = tree->nodes[node].parent;
+    if (state[node] != InCut || parent < 0) continue;
+    if (error(parent, view, scale) > tolerance/2) continue;
+
+    const Octree::Node& p = tree->nodes[parent];
+    bool merge = true;
+    for (int c = p.firstChild; c < p.firstChild + p.childCount; c++)
+      merge = merge && state[c] == InCut;
+    if (!merge) continue;
+
+    for (int c = p.firstChild; c < p.firstChild + p.childCount; c++)
+      state[c] = NotDrawn;
+    state[parent] = InCut;
+    points -= p.childCount - 1;
+    added.push_back(parent);
+  }
+
+  if (added.empty()) return false;
+
+  std::vector<int> kept;
+  kept.reserve(cut.size() + added.size());
+  for (unsigned i = 0; i < cut.size(); i++)
+    if (state[cut[i]] == InCut) kept.push_back(cut[i]);
+  for (unsigned i = 0; i < added.size(); i++)
+    if (state[added[i]] == InCut) kept.push_back(added[i]);
+  cut.swap(kept);
+
+  kept.clear();
+  for (unsigned i = 0; i < leaves.size(); i++)
+    if (state[leaves[i]] == Expanded) kept.push_back(leaves[i]);
+  leaves.swap(kept);
+  return true;
+}
+
+bool OctreeCut::refine(const View& view, double scale) {
+  std::vector<std::pair<double, int> > queue;
+  for (unsigned i = 0; i < cut.size(); i++) {
+    const double e = error(cut[i], view, scale);
+    if (e > tolerance) queue.push_back(std::make_pair(e, cut[i]));
+  }
+  std::make_heap(queue.begin(), queue.end());
+
+  std::vector<int> added;
+  int refined = 0;
+  bool pending = false;
+  while (!queue.empty()) {
+    if (refined == refineBudget) {
+      pending = true;
+      break;
+    }
+    std::pop_heap(queue.begin(), queue.end());
+    const int node = queue.back().second;
+    queue.pop_back();
+
+    const Octree::Node& a = tree->nodes[node];
+    if (tree->isLeaf(node)) {
+      const int extra = tree->count(node) - 1;
+      if (points + extra > pointBudget) break;
+      state[node] = Expanded;
+      leaves.push_back(node);
+      points += extra;
+    } else {
+      const int extra = a.childCount - 1;
+      if (points + extra > pointBudget) break;
+      state[node] = NotDrawn;
+      for (int c = a.firstChild; c < a.firstChild + a.childCount; c++) {
+        state[c] = InCut;
+        added.push_back(c);
+        const double e = error(c, view, scale);
+        if (e > tolerance) {
+          queue.push_back(std::make_pair(e, c));
+          std::push_heap(queue.begin(), queue.end());
+        }
+      }
+      points += extra;
+    }
+    refined++;
+  }
+
+  if (refined > 0) {
+    std::vector<int> kept;
+    kept.reserve(cut.size() + added.size());
+    for (unsigned i = 0; i < cut.size(); i++)
+      if (state[cut[i]] == InCut) kept.push_back(cut[i]);
+    for (unsigned i = 0; i < added.size(); i++)
+      if (state[added[i]] == InCut) kept.push_back(added[i]);
+    cut.swap(kept);
+  }
+  return pending;
+}
+
+bool OctreeCut::update(const View& view) {
+  if (tree == 0 || tree->isEmpty()) return true;
+
+  // repaints without camera motion
+  bool moved = view.extent != last.extent || view.pixels != last.pixels;
+  for (int k = 0; k < 16; k++)
+    moved = moved || view.modelview[k] != last.modelview[k];
+  if (converged && !moved) return true;
+  last = view;
+
+  const double* m = view.modelview;
+  const double scale = std::sqrt(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+
+  while (coarsen(view, scale)) {}
+  converged = !refine(view, scale);
+  return converged;
+}
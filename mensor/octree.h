@@ -0,0 +1,141 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <vector>
+
+#include "bps_particle-array.h"
+
+// Level-of-detail hierarchy over a particle snapshot. The particles are
+// sorted along a Morton curve, so every node covers a contiguous range of
+// the reordered points and a leaf can be drawn with a single draw call.
+// Every node also carries a representative (centroid, total mass, mean
+// color) that is drawn instead of its particles when the node is small on
+// screen.
+class Octree {
+  public:
+    struct Node {
+      float centroid[3];
+      float center[3];  // of the cube
+      float halfSize;
+      float mass;
+      unsigned char color[3];
+      int parent;
+      int firstChild;   // children are contiguous, -1 for leaves
+      int childCount;
+      int begin, end;   // points
+    };
+
+    std::vector<Node> nodes;           // nodes[0] is the root
+    std::vector<float> points;         // x, y, z
+    std::vector<unsigned char> colors; // r, g, b
+
+  protected:
+    int leafSize;
+
+    void split(int node, const std::vector<unsigned long long>& codes,
+               int depth);
+    void summarize(int node, const std::vector<float>& weights);
+
+  public:
+    Octree(int leafSize = 32);
+
+    // positive charges are red, negative ones blue, neutral ones grey
+    void build(const bps::ParticleArray& particles);
+    void clear();
+
+    inline bool isEmpty() const { return nodes.empty(); }
+    inline bool isLeaf(int node) const { return nodes[node].firstChild < 0; }
+    inline int count(int node) const {
+      return nodes[node].end - nodes[node].begin;
+    }
+
+    // smallest sphere around the cube of the root
+    void bounds(float center[3], float& radius) const;
+};
+
+// The nodes drawn for one view: representatives of nodes and the points of
+// expanded leaves. A node is refined while its cube covers more than
+// tolerance pixels and coarsened again below half of that. update() only
+// changes the cut of the previous frame, largest screen-space error first,
+// and stops at the point and refinement budgets, so the work per frame is
+// bounded independently of the number of particles. Nodes outside of the
+// view are not refined.
+class OctreeCut {
+  public:
+    // orthographic view: the modelview matrix (column-major, as returned
+    // by glGetDoublev), the half width of the visible square in eye
+    // coordinates and its width in pixels
+    struct View {
+      double modelview[16];
+      double extent;
+      int pixels;
+    };
+
+  protected:
+    enum State { NotDrawn, InCut, Expanded };
+
+    const Octree* tree;
+    std::vector<unsigned char> state;
+    std::vector<int> cut;
+    std::vector<int> leaves;
+    int points;
+
+    View last;       // view of the last update
+    bool converged;  // and whether it was reached
+
+    double tolerance;
+    int pointBudget;
+    int refineBudget;
+
+    double error(int node, const View& view, double scale) const;
+    bool coarsen(const View& view, double scale);
+    bool refine(const View& view, double scale);
+
+  public:
+    OctreeCut(double tolerance = 2, int pointBudget = 1000000,
+              int refineBudget = 50000);
+
+    // starts over with the root of tree
+    void reset(const Octree& tree);
+
+    // adapts the cut to view, returns false if it has not converged yet
+    // and another update is needed
+    bool update(const View& view);
+
+    inline const std::vector<int>& nodes() const { return cut; }
+    inline const std::vector<int>& expandedLeaves() const { return leaves; }
+    inline int pointCount() const { return points; }
+
+    inline void setTolerance(double pixels) {
+      tolerance = pixels;
+      converged = false;
+    }
+    inline void setPointBudget(int budget) {
+      pointBudget = budget;
+      converged = false;
+    }
+    inline void setRefineBudget(int budget) {
+      refineBudget = budget;
+      converged = false;
+    }
+};
+
+#endif // OCTREE_H
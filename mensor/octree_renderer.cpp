@@ -0,0 +1,111 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "bps_particle-array.h"
+#include "octree.h"
+#include "octree_renderer.h"
+
+OctreeRenderer::OctreeRenderer() : side(1) {
+}
+
+void OctreeRenderer::setParticles(const bps::ParticleArray& particles) {
+  octree.build(particles);
+  cut.reset(octree);
+}
+
+void OctreeRenderer::initialize() {
+  glClearColor(0.5, 0.5, 0.5, 0.0);
+  glEnable(GL_DEPTH_TEST);
+  glPointSize(2.0);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+}
+
+void OctreeRenderer::resize(int width, int height) {
+  side = std::max(std::min(width, height), 1);
+  glViewport((width - side) / 2, (height - side) / 2, side, side);
+}
+
+bool OctreeRenderer::paint(const Camera& camera) {
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if (octree.isEmpty()) return true;
+
+  // the bounding sphere of the snapshot fills the viewport at zoom 1
+  const double extent = 0.5 / camera.zoom;
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(-extent, +extent, +extent, -extent, 4.0, 15.0);
+  glMatrixMode(GL_MODELVIEW);
+
+  float center[3], radius;
+  octree.bounds(center, radius);
+  glLoadIdentity();
+  glTranslated(camera.xPan, camera.yPan, -10.0);
+  glRotated(camera.xRot, 1.0, 0.0, 0.0);
+  glRotated(camera.yRot, 0.0, 1.0, 0.0);
+  glScaled(0.5 / radius, 0.5 / radius, 0.5 / radius);
+  glTranslated(-center[0], -center[1], -center[2]);
+
+  OctreeCut::View view;
+  glGetDoublev(GL_MODELVIEW_MATRIX, view.modelview);
+  view.extent = extent;
+  view.pixels = side;
+  const bool converged = cut.update(view);
+
+  // expanded leaves are ranges of the sorted points, neighbours are merged
+  const std::vector<int>& leaves = cut.expandedLeaves();
+  ranges.clear();
+  for (unsigned i = 0; i < leaves.size(); i++) {
+    const Octree::Node& node = octree.nodes[leaves[i]];
+    ranges.push_back(std::make_pair(node.begin, node.end));
+  }
+  std::sort(ranges.begin(), ranges.end());
+
+  glVertexPointer(3, GL_FLOAT, 0, &octree.points[0]);
+  glColorPointer(3, GL_UNSIGNED_BYTE, 0, &octree.colors[0]);
+  for (unsigned i = 0; i < ranges.size(); ) {
+    const int begin = ranges[i].first;
+    int end = ranges[i].second;
+    for (i++; i < ranges.size() && ranges[i].first == end; i++)
+      end = ranges[i].second;
+    glDrawArrays(GL_POINTS, begin, end - begin);
+  }
+
+  const std::vector<int>& nodes = cut.nodes();
+  if (!nodes.empty()) {
+    nodePoints.resize(3 * nodes.size());
+    nodeColors.resize(3 * nodes.size());
+    for (unsigned i = 0; i < nodes.size(); i++) {
+      const Octree::Node& node = octree.nodes[nodes[i]];
+      for (int d = 0; d < 3; d++) {
+        nodePoints[3 * i + d] = node.centroid[d];
+        nodeColors[3 * i + d] = node.color[d];
+      }
+    }
+    glVertexPointer(3, GL_FLOAT, 0, &nodePoints[0]);
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, &nodeColors[0]);
+    glDrawArrays(GL_POINTS, 0, nodes.size());
+  }
+  return converged;
+}
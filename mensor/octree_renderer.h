@@ -0,0 +1,74 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef OCTREE_RENDERER_H
+#define OCTREE_RENDERER_H
+
+#include <utility>
+#include <vector>
+
+#include "bps_particle-array.h"
+#include "octree.h"
+
+// Draws a particle snapshot with fixed-function OpenGL through an
+// OctreeCut. It needs a current GL context but no Qt, so the drawing can
+// also be checked offscreen.
+class OctreeRenderer {
+  public:
+    // zoom 1 fits the bounding sphere of the snapshot into the viewport;
+    // rotations are in degrees, pans in eye coordinates
+    struct Camera {
+      double zoom;
+      double xRot, yRot;
+      double xPan, yPan;
+
+      Camera() : zoom(1), xRot(0), yRot(0), xPan(0), yPan(0) {}
+    };
+
+  private:
+    Octree octree;
+    OctreeCut cut;
+
+    // representatives of the cut and ranges of expanded leaves
+    std::vector<float> nodePoints;
+    std::vector<unsigned char> nodeColors;
+    std::vector<std::pair<int, int> > ranges;
+
+    int side;  // of the viewport in pixels
+
+  public:
+    OctreeRenderer();
+
+    void setParticles(const bps::ParticleArray& particles);
+
+    inline const Octree& tree() const { return octree; }
+    inline OctreeCut& lodCut() { return cut; }
+    inline int viewportSide() const { return side; }
+
+    void initialize();
+
+    // the viewport is the largest centered square
+    void resize(int width, int height);
+
+    // sets up the matrices of camera and draws the cut; returns false if
+    // the cut has not converged yet and another frame should follow
+    bool paint(const Camera& camera);
+};
+
+#endif // OCTREE_RENDERER_H
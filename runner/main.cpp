@@ -0,0 +1,195 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "simulation.h"
+#include "sweep.h"
+
+// Runs every simulation of a sweep without a display. The runs are
+// independent, so each worker thread takes the next run from a shared
+// counter and runs it single-threaded; a summary line is appended to the
+// results file as soon as a run finishes (in completion order, the first
+// column gives the position in the sweep).
+
+namespace {
+
+  void usage() {
+    std::cerr << "usage: bps_run [-j threads] [-o results] sweep-file"
+              << std::endl;
+  }
+
+  double now() {
+    timeval t;
+    gettimeofday(&t, 0);
+    return t.tv_sec + 1e-6*t.tv_usec;
+  }
+
+#ifdef __linux__
+  // pins the calling thread to the k-th processor (cyclically) of those
+  // the process may run on
+  void pinThread(const cpu_set_t& allowed, const int k) {
+    const int count = CPU_COUNT(&allowed);
+    if (count == 0) return;
+
+    int skip = k % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (!CPU_ISSET(cpu, &allowed) || skip-- > 0) continue;
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      sched_setaffinity(0, sizeof(set), &set);
+      return;
+    }
+  }
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* sweepFile = 0;
+  const char* outputFile = 0;
+  int threads = -1;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      // the same range as the threads setting of a sweep
+      char* end;
+      const long j = std::strtol(argv[++i], &end, 10);
+      if (*argv[i] == '\0' || *end != '\0' || j < 0 || j > 4096) {
+        usage();
+        return 1;
+      }
+      threads = j;
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outputFile = argv[++i];
+    } else if (argv[i][0] != '-' && sweepFile == 0) {
+      sweepFile = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (sweepFile == 0) {
+    usage();
+    return 1;
+  }
+
+  std::ifstream in(sweepFile);
+  if (!in) {
+    std::cerr << "bps_run: cannot open " << sweepFile << std::endl;
+    return 1;
+  }
+  Sweep sweep;
+  std::string error;
+  if (!sweep.read(in, error)) {
+    std::cerr << "bps_run: " << sweepFile << ", " << error << std::endl;
+    return 1;
+  }
+
+  const std::string output = outputFile ? outputFile : sweep.getOutput();
+  std::ofstream out(output.c_str());
+  if (!out) {
+    std::cerr << "bps_run: cannot write " << output << std::endl;
+    return 1;
+  }
+  out.precision(10);
+
+  const std::vector<std::string>& names = sweep.names();
+  out << "run\tseed";
+  for (unsigned int k = 0; k < names.size(); k++)
+    out << '\t' << names[k];
+  out << "\tekin0\tekin\tvrms\tbuilds\tseconds\tstatus" << std::endl;
+
+  if (threads < 0) threads = sweep.getThreads();
+#ifdef _OPENMP
+  if (threads <= 0) threads = omp_get_num_procs();
+  // the library's own parallel loops run serially inside the workers
+  omp_set_max_active_levels(1);
+#else
+  threads = 1;
+#endif
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+#endif
+
+  const int count = sweep.runCount();
+  int next = 0;
+  int failed = 0;
+  const double start = now();
+
+  #pragma omp parallel num_threads(threads)
+  {
+    int worker = 0;
+#ifdef _OPENMP
+    worker = omp_get_thread_num();
+#endif
+#ifdef __linux__
+    if (sweep.getPin()) pinThread(allowed, worker);
+#endif
+
+    Simulation simulation(sweep.getModel(), names);
+    for (;;) {
+      int index;
+      #pragma omp atomic capture
+      index = next++;
+      if (index >= count) break;
+
+      const Sweep::Run run = sweep.run(index);
+      const Simulation::Summary s = simulation.run(run);
+
+      std::ostringstream line;
+      line.precision(10);
+      line << run.index << '\t' << run.seed;
+      for (unsigned int k = 0; k < run.values.size(); k++)
+        line << '\t' << run.values[k];
+      line << '\t' << s.initialKineticEnergy << '\t' << s.kineticEnergy
+           << '\t' << s.rmsSpeed << '\t' << s.neighbourListBuilds
+           << '\t' << s.seconds << '\t' << s.status << '\n';
+
+      #pragma omp critical(output)
+      {
+        out << line.str() << std::flush;
+        if (s.status != "ok") failed++;
+      }
+    }
+  }
+
+  const double seconds = now() - start;
+  std::cerr << "bps_run: " << count << " runs (" << failed
+            << " skipped or diverged) in " << seconds << " s on " << threads
+            << " threads, " << 3600*count/seconds << " runs/hour" << std::endl;
+  return 0;
+}
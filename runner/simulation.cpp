@@ -0,0 +1,255 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "bps_constants.h"
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_periodic-box.h"
+#include "bps_short-range.h"
+#include "simulation.h"
+#include "sweep.h"
+
+using namespace bps;
+
+namespace {
+
+  enum Parameter {
+    Particles, Steps, Dt, Density, Temperature, Mass, Charge, Debye, Cutoff,
+    ParameterCount
+  };
+
+  const char* const parameterNames[ParameterCount] = {
+    "particles", "steps", "dt", "density", "temperature", "mass", "charge",
+    "debye", "cutoff"
+  };
+
+  // a cutoff of 0 stands for three Debye lengths
+  const double parameterDefaults[ParameterCount] = {
+    1000, 100, 1e-13, 1e20, 1e4, BPS_CONST_MASS_PROTON,
+    BPS_CONST_ELEMENTARY_CHARGE, 1e-7, 0
+  };
+
+  int parameterIndex(const std::string& name) {
+    for (int k = 0; k < ParameterCount; k++)
+      if (name == parameterNames[k]) return k;
+    return -1;
+  }
+
+  double now() {
+    timeval t;
+    gettimeofday(&t, 0);
+    return t.tv_sec + 1e-6*t.tv_usec;
+  }
+
+  // SplitMix64; small, and the stream depends on the seed only, so a run
+  // gives the same result on whichever thread it is scheduled
+  class Random {
+    protected:
+      unsigned long long state;
+
+    public:
+      Random(const unsigned long seed) : state(seed) {}
+
+      unsigned long long next() {
+        unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+      }
+
+      // uniform in [0, 1)
+      double uniform() { return (next() >> 11)*(1.0/9007199254740992.0); }
+
+      // standard normal (Box-Muller)
+      double normal() {
+        const double u = 1 - uniform();
+        return std::sqrt(-2*std::log(u))*std::cos(2*M_PI*uniform());
+      }
+  };
+
+} // namespace
+
+Simulation::Simulation(const std::string& _model,
+                       const std::vector<std::string>& names)
+        : model(_model), force(1, 1, 0) {
+  for (unsigned int i = 0; i < names.size(); i++)
+    slot.push_back(parameterIndex(names[i]));
+}
+
+bool Simulation::isModel(const std::string& name) {
+  return name == "plasma" || name == "gravity";
+}
+
+bool Simulation::isParameter(const std::string& name) {
+  return parameterIndex(name) >= 0;
+}
+
+bool Simulation::isValid(const std::string& name, const double value,
+                         std::string& allowed) {
+  // the comparisons with DBL_MAX are false for NaN as well
+  const int k = parameterIndex(name);
+  if (k == Particles || k == Steps) {
+    allowed = "whole numbers up to 2^31 - 1";
+    return value >= 0 && value <= INT_MAX && value == std::floor(value);
+  }
+  if (k == Charge) {
+    allowed = "finite numbers";
+    return std::fabs(value) <= DBL_MAX;
+  }
+  if (k == Cutoff) {
+    allowed = "finite numbers >= 0";
+    return value >= 0 && value <= DBL_MAX;
+  }
+  allowed = "positive finite numbers";
+  return value > 0 && value <= DBL_MAX;
+}
+
+Simulation::Summary Simulation::run(const Sweep::Run& r) {
+  double p[ParameterCount];
+  for (int k = 0; k < ParameterCount; k++)
+    p[k] = parameterDefaults[k];
+  for (unsigned int i = 0; i < slot.size(); i++)
+    p[slot[i]] = r.values[i];
+  if (p[Cutoff] == 0) p[Cutoff] = 3*p[Debye];
+
+  Summary s;
+  s.initialKineticEnergy = s.kineticEnergy = s.rmsSpeed = 0;
+  s.neighbourListBuilds = 0;
+  s.status = "ok";
+  s.seconds = 0;
+
+  // Sweep::read rejects these already, runs may come from elsewhere
+  for (unsigned int i = 0; i < slot.size(); i++) {
+    std::string allowed;
+    if (slot[i] < 0 || !isValid(parameterNames[slot[i]], r.values[i],
+                                allowed)) {
+      s.status = slot[i] < 0 ? "unknown parameter"
+                 : std::string(parameterNames[slot[i]]) + " takes "
+                   + allowed;
+      return s;
+    }
+  }
+
+  const double start = now();
+  if (model == "plasma")
+    runPlasma(p, r.seed, s);
+  else
+    runGravity(p, r.seed, s);
+  s.seconds = now() - start;
+  if (s.status == "ok" && !(std::fabs(s.kineticEnergy) <= DBL_MAX))
+    s.status = "diverged";
+  return s;
+}
+
+void Simulation::runPlasma(const double* p, const unsigned long seed,
+                           Summary& s) {
+  const int n = static_cast<int>(p[Particles]);
+  const int steps = static_cast<int>(p[Steps]);
+  const double length = std::pow(n/p[Density], 1.0/3);
+  const double skin = 0.1*p[Cutoff];
+  if (p[Cutoff] + skin > length/2) {
+    s.status = "cutoff exceeds half the box";
+    return;
+  }
+
+  const PeriodicBox box(length, length, length);
+  const double sigma = std::sqrt(BPS_CONST_BOLTZMANN*p[Temperature]/p[Mass]);
+  Random random(seed);
+
+  // resize keeps the capacity of earlier runs
+  particles.resize(n);
+  for (int i = 0; i < n; i++) {
+    Particle& q = particles[i];
+    q.position = ThreeVector(length*random.uniform(),
+                             length*random.uniform(),
+                             length*random.uniform());
+    q.velocity = ThreeVector(sigma*random.normal(), sigma*random.normal(),
+                             sigma*random.normal());
+    q.mass = p[Mass];
+    q.charge = p[Charge];
+  }
+
+  double ekin = 0;
+  for (int i = 0; i < n; i++)
+    ekin += 0.5*p[Mass]*(particles[i].velocity*particles[i].velocity);
+  s.initialKineticEnergy = ekin;
+
+  // keeps the buffers of the Verlet list from earlier runs
+  force.reconfigure(p[Debye], p[Cutoff], skin, box);
+  for (int t = 0; t < steps; t++) {
+    for (int i = 0; i < n; i++)
+      particles[i].dv = ThreeVector(0, 0, 0);
+    force.apply(particles, p[Dt]);
+    for (int i = 0; i < n; i++)
+      particles[i].updatePosition(p[Dt], box);
+  }
+
+  ekin = 0;
+  for (int i = 0; i < n; i++)
+    ekin += 0.5*p[Mass]*(particles[i].velocity*particles[i].velocity);
+  s.kineticEnergy = ekin;
+  s.rmsSpeed = n > 0 ? std::sqrt(2*ekin/(n*p[Mass])) : 0;
+  s.neighbourListBuilds = force.neighbourList().buildCount();
+}
+
+void Simulation::runGravity(const double* p, const unsigned long seed,
+                            Summary& s) {
+  const int n = static_cast<int>(p[Particles]);
+  const int steps = static_cast<int>(p[Steps]);
+  const double length = std::pow(n/p[Density], 1.0/3);
+  const double sigma = std::sqrt(BPS_CONST_BOLTZMANN*p[Temperature]/p[Mass]);
+  Random random(seed);
+
+  array.resize(n);
+  for (int i = 0; i < n; i++) {
+    array.x[i] = length*random.uniform();
+    array.y[i] = length*random.uniform();
+    array.z[i] = length*random.uniform();
+    array.vx[i] = sigma*random.normal();
+    array.vy[i] = sigma*random.normal();
+    array.vz[i] = sigma*random.normal();
+    array.mass[i] = p[Mass];
+    array.charge[i] = p[Charge];
+  }
+
+  double ekin = 0;
+  for (int i = 0; i < n; i++)
+    ekin += array.vx[i]*array.vx[i] + array.vy[i]*array.vy[i]
+            + array.vz[i]*array.vz[i];
+  s.initialKineticEnergy = 0.5*p[Mass]*ekin;
+
+  for (int t = 0; t < steps; t++) {
+    array.clearDv();
+    array.gravitationalForces(p[Dt]);
+    array.updatePositions(p[Dt]);
+  }
+
+  ekin = 0;
+  for (int i = 0; i < n; i++)
+    ekin += array.vx[i]*array.vx[i] + array.vy[i]*array.vy[i]
+            + array.vz[i]*array.vz[i];
+  s.kineticEnergy = 0.5*p[Mass]*ekin;
+  s.rmsSpeed = n > 0 ? std::sqrt(ekin/n) : 0;
+}
@@ -0,0 +1,91 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <string>
+#include <vector>
+
+#include "bps_particle.h"
+#include "bps_particle-array.h"
+#include "bps_short-range.h"
+#include "sweep.h"
+
+// Workspace of one worker thread. It runs the simulations of a sweep one
+// after another and keeps its particle buffers and neighbour lists, so
+// only the first run (or a larger one) allocates.
+//
+// Models:
+//   plasma   screened Coloumb particles in a periodic box (Verlet list)
+//   gravity  all-pairs gravity with open boundaries (ParticleArray)
+//
+// Parameters and their defaults:
+//   particles    1000      number of particles
+//   steps        100       time steps
+//   dt           1e-13     s
+//   density      1e20      m^-3, gives the box length
+//   temperature  1e4       K, of the initial Maxwell distribution
+//   mass         m_p       kg
+//   charge       e         A s
+//   debye        1e-7      m, screening length (plasma)
+//   cutoff       3 debye   m, interaction cutoff (plasma)
+//
+// particles and steps take whole numbers >= 0, charge any finite number,
+// cutoff finite numbers >= 0 (0 for three Debye lengths) and all others
+// positive finite numbers. A run with other values, or one whose energy
+// does not stay finite, is not simulated to the end and gets a status
+// other than "ok".
+class Simulation {
+  public:
+    struct Summary {
+      double initialKineticEnergy;  // J
+      double kineticEnergy;         // J, after the last step
+      double rmsSpeed;              // m s^-1, after the last step
+      int neighbourListBuilds;
+      double seconds;               // wall-clock time
+      std::string status;           // "ok" or why the run was skipped
+    };
+
+  protected:
+    std::string model;
+    std::vector<int> slot;  // parameter of each sweep value
+
+    std::vector<bps::Particle> particles;
+    bps::ParticleArray array;
+    bps::ScreenedColoumbForce force;
+
+  public:
+    Simulation(const std::string& _model,
+               const std::vector<std::string>& names);
+
+    Summary run(const Sweep::Run& r);
+
+    static bool isModel(const std::string& name);
+    static bool isParameter(const std::string& name);
+    // whether the parameter takes the value; describes the values it
+    // takes in allowed otherwise
+    static bool isValid(const std::string& name, const double value,
+                        std::string& allowed);
+
+  protected:
+    void runPlasma(const double* p, const unsigned long seed, Summary& s);
+    void runGravity(const double* p, const unsigned long seed, Summary& s);
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,209 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+#include "sweep.h"
+
+namespace {
+
+  std::string trim(const std::string& s) {
+    const std::string::size_type begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    const std::string::size_type end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+  }
+
+  bool parseNumber(const std::string& word, double& x) {
+    char* end;
+    x = std::strtod(word.c_str(), &end);
+    return !word.empty() && *end == '\0';
+  }
+
+  // digits only, so that strtoul cannot wrap "-1" around
+  bool parseCount(const std::string& word, unsigned long& x) {
+    if (word.empty() ||
+        word.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+    errno = 0;
+    x = std::strtoul(word.c_str(), 0, 10);
+    return errno == 0;
+  }
+
+  // so that a typo cannot start billions of runs or threads
+  const unsigned long maxSeeds = 1000000;
+  const unsigned long maxThreads = 4096;
+
+
+} // namespace
+
+Sweep::Sweep() : model("plasma"), output("results.tsv"), threads(0),
+                 pin(true) {}
+
+bool Sweep::read(std::istream& in, std::string& error) {
+  std::string line;
+  for (int number = 1; std::getline(in, line); number++) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+
+    std::ostringstream where;
+    where << "line " << number << ": ";
+
+    const std::string::size_type equal = line.find('=');
+    if (equal == std::string::npos) {
+      error = where.str() + "expected key = values";
+      return false;
+    }
+    const std::string key = trim(line.substr(0, equal));
+    std::vector<std::string> words;
+    std::istringstream list(line.substr(equal + 1));
+    for (std::string word; list >> word; )
+      words.push_back(word);
+    if (words.empty()) {
+      error = where.str() + "no value for " + key;
+      return false;
+    }
+
+    if (key == "model" || key == "output" || key == "threads" ||
+        key == "pin") {
+      if (words.size() != 1) {
+        error = where.str() + key + " takes a single value";
+        return false;
+      }
+      if (key == "model") {
+        if (!Simulation::isModel(words[0])) {
+          error = where.str() + "unknown model " + words[0];
+          return false;
+        }
+        model = words[0];
+      } else if (key == "output") {
+        output = words[0];
+      } else if (key == "threads") {
+        unsigned long count;
+        if (!parseCount(words[0], count) || count > maxThreads) {
+          error = where.str() + "threads takes a whole number up to 4096";
+          return false;
+        }
+        threads = count;
+      } else {
+        if (words[0] != "yes" && words[0] != "no") {
+          error = where.str() + "pin takes yes or no";
+          return false;
+        }
+        pin = words[0] == "yes";
+      }
+      continue;
+    }
+
+    if (key == "seeds") {
+      seeds.clear();
+      for (unsigned int i = 0; i < words.size(); i++) {
+        const std::string::size_type colon = words[i].find(':');
+        unsigned long first, last;
+        if (!parseCount(words[i].substr(0, colon), first) ||
+            !parseCount(colon == std::string::npos ? words[i]
+                        : words[i].substr(colon + 1), last)) {
+          error = where.str() + "not a seed or range a:b: " + words[i];
+          return false;
+        }
+        if (colon == std::string::npos) last = first;
+        if (first > last) {
+          error = where.str() + "empty seed range " + words[i];
+          return false;
+        }
+        if (last - first >= maxSeeds - seeds.size()) {
+          error = where.str() + "more than a million seeds";
+          return false;
+        }
+        for (unsigned long seed = first; seed <= last; seed++)
+          seeds.push_back(seed);
+      }
+      continue;
+    }
+
+    if (!Simulation::isParameter(key)) {
+      error = where.str() + "unknown parameter " + key;
+      return false;
+    }
+    std::vector<double> values(words.size());
+    for (unsigned int i = 0; i < words.size(); i++) {
+      if (!parseNumber(words[i], values[i])) {
+        error = where.str() + "not a number: " + words[i];
+        return false;
+      }
+      std::string allowed;
+      if (!Simulation::isValid(key, values[i], allowed)) {
+        error = where.str() + key + " takes " + allowed + ", not "
+                + words[i];
+        return false;
+      }
+    }
+
+    // a repeated key replaces the earlier values
+    unsigned int k = 0;
+    while (k < parameterNames.size() && parameterNames[k] != key) k++;
+    if (k == parameterNames.size()) {
+      parameterNames.push_back(key);
+      parameterValues.push_back(values);
+    } else {
+      parameterValues[k] = values;
+    }
+  }
+
+  if (seeds.empty()) seeds.push_back(1);
+
+  // run indices are ints
+  double count = seeds.size();
+  for (unsigned int k = 0; k < parameterValues.size(); k++)
+    count *= parameterValues[k].size();
+  if (count > INT_MAX) {
+    error = "too many runs";
+    return false;
+  }
+  return true;
+}
+
+int Sweep::runCount() const {
+  int count = seeds.size();
+  for (unsigned int k = 0; k < parameterValues.size(); k++)
+    count *= parameterValues[k].size();
+  return count;
+}
+
+Sweep::Run Sweep::run(const int index) const {
+  // the seed varies fastest, so the runs of one parameter set are adjacent
+  Run r;
+  r.index = index;
+  r.seed = seeds[index % seeds.size()];
+  r.values.resize(parameterNames.size());
+
+  int rest = index/seeds.size();
+  for (int k = parameterValues.size() - 1; k >= 0; k--) {
+    const int m = parameterValues[k].size();
+    r.values[k] = parameterValues[k][rest % m];
+    rest /= m;
+  }
+  return r;
+}
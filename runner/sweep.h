@@ -0,0 +1,78 @@
+/*
+   BPS - Basic Particle Simulations
+   Copyright (C) 2006  Frank S. Thomas <frank@thomas-alfeld.de>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// Parameter sweep read from a text file with one "key = values" line per
+// setting and '#' comments, e.g.
+//
+//   model = plasma
+//   particles = 500 1000 2000
+//   temperature = 1e4 1e5
+//   seeds = 1:20
+//   output = results.tsv
+//
+// Every simulation parameter may list several values; the sweep runs the
+// Cartesian product of all lists once for every seed. "seeds" takes
+// numbers and inclusive ranges a:b, up to a million seeds in all.
+// "model", "output", "threads" (0 uses all cores) and "pin" (yes or no)
+// are settings with a single value.
+class Sweep {
+  public:
+    struct Run {
+      int index;
+      unsigned long seed;
+      std::vector<double> values;  // in the order of Sweep::names()
+    };
+
+  protected:
+    std::string model;
+    std::string output;
+    int threads;
+    bool pin;
+
+    std::vector<std::string> parameterNames;
+    std::vector<std::vector<double> > parameterValues;
+    std::vector<unsigned long> seeds;
+
+  public:
+    Sweep();
+
+    // returns false and describes the problem in error if the
+    // specification is invalid
+    bool read(std::istream& in, std::string& error);
+
+    inline const std::string& getModel() const { return model; }
+    inline const std::string& getOutput() const { return output; }
+    inline int getThreads() const { return threads; }
+    inline bool getPin() const { return pin; }
+
+    inline const std::vector<std::string>& names() const {
+      return parameterNames;
+    }
+
+    int runCount() const;
+    Run run(const int index) const;
+};
+
+#endif // SWEEP_H